@@ -0,0 +1,227 @@
+#coding:utf8
+"""
+Accuracy and efficiency of physics lists, cuts and biasing options.
+
+For each configuration, the Faddegon 1991 setup (15 MeV e- on Al or Pb) is run
+with fixed seeds, and the rear-face photon spectra at 0, 10, 30 and 60 deg are
+compared with the experimental data. For each configuration, the benchmark
+reports the wall time T, the reduced chi2 against experiment, the mean relative
+error sigma of the simulated spectra, and the figure of merit 1/(sigma^2 T).
+The cheapest configuration that still matches the data is the one with the
+highest figure of merit among those with a reduced chi2 below the limit.
+
+The configurations are given as a JSON dict {name: [commands]}, the commands
+being inserted before /run/initialize, in addition to the ones of
+`run_<material>.mac`. The last /physics/setPhysicsList and /run/setCut commands
+replace the ones of the macro.
+
+Usage (from the root dir) :
+  python3 benchmarks/2/fom.py material [events] [threads] [chi2Limit] [configs.json]
+"""
+
+import os
+import re
+import sys
+import json
+import glob
+import subprocess
+import numpy as np
+
+SRC = "../../build/gp3m2"
+
+# Experimental parameters, see analysis.py
+E0     = 0.145 # MeV
+A0     = 0.4   # deg
+ANGLES = [0, 10, 30, 60]
+THICKNESS = {"Al" : 36000, "Pb" : 8000} # um
+
+CONFIGS = {
+  "penelope"      : ["/physics/setPhysicsList penelope"],
+  "standard"      : ["/physics/setPhysicsList standard"],
+  "standard_cut"  : ["/physics/setPhysicsList standard", "/run/setCut 100 um"],
+  "standard_brem" : ["/physics/setPhysicsList standard", "/physics/setBremSplitting world 10"],
+}
+
+def make_macro(material,name,commands,events):
+  """
+  Write the macro of a configuration from `run_<material>.mac` and return its
+  name.
+
+  Parameters
+  ----------
+  material : str
+    target material (Al or Pb)
+  name : str
+    configuration name
+  commands : list of str
+    configuration commands
+  events : int
+    number of events
+  """
+  with open("run_%s.mac"%material) as f:
+    lines = [l.rstrip("\n") for l in f]
+
+  keys = ["/physics/setPhysicsList","/run/setCut","/run/beamOn","/run/numberOfThreads","/diags/setFileBaseName"]
+  physics  = ["/physics/setPhysicsList standard"] + [c for c in commands if c.split()[0] == keys[0]]
+  replaced = [c for c in commands if c.split()[0] in keys[1:]]
+  inserted = [c for c in commands if c.split()[0] not in keys]
+
+  # the physics list is only taken into account before the kernel initialization
+  macro = []
+  for l in lines:
+    key = l.split()[0] if l.strip() else ""
+    if key in keys:
+      continue
+    if key == "/run/initialize":
+      macro.append(physics[-1])
+      macro += inserted
+      macro.append("/random/setSeeds 12345 67890")
+    macro.append(l)
+  macro += ["/run/setCut 1 mm"]
+  macro += replaced
+  macro += ["/diags/setFileBaseName fom_%s_%s"%(material,name),
+            "/performance/setFileName none",
+            "/summary/setFileName none",
+            "/run/beamOn %d"%events]
+
+  filename = "fom_%s_%s.mac"%(material,name)
+  with open(filename,"w") as f:
+    f.write("\n".join(macro) + "\n")
+  return filename
+
+def run(macro,threads):
+  """
+  Launch a macro and return the wall time of the run in s.
+
+  Parameters
+  ----------
+  macro : str
+    macro file name
+  threads : int
+    number of threads
+  """
+  env = dict(os.environ)
+  env["G4FORCENUMBEROFTHREADS"] = str(threads)
+  out = subprocess.run([SRC,"-t",str(threads),"-m",macro],env=env,stdout=subprocess.PIPE,
+                       stderr=subprocess.STDOUT,universal_newlines=True).stdout
+  res = re.findall(r"scaling : \d+ events ; \d+ threads ; wall time ([\d.e+-]+) s",out)
+  if not res:
+    print(out[-2000:])
+    raise RuntimeError("No scaling report found for %s"%macro)
+  return float(res[-1])
+
+def read_experiment(material):
+  """
+  Return the experimental bin edges, and the spectra and errors per angle.
+
+  Each experimental value is given at the upper edge of its energy bin, the
+  lower edge of the first bin being 0.14 MeV (see analysis.py).
+
+  Parameters
+  ----------
+  material : str
+    target material (Al or Pb)
+  """
+  data  = np.loadtxt("Faddegon_1991_%s.dat"%material)
+  edges = np.array([0.14] + list(data[:,0]))
+  spectra = {a : (data[:,1+2*i], data[:,2+2*i]) for i,a in enumerate([0,10,30,60,90])}
+  return edges,spectra
+
+def read_spectra(material,name,edges):
+  """
+  Return the simulated rear-face photon spectra and their statistical errors
+  per angle, in number/MeV/sr/incident e-.
+
+  The error of each bin is sqrt(sum w^2), which neglects the correlation of
+  the photons of a same shower.
+
+  Parameters
+  ----------
+  material : str
+    target material (Al or Pb)
+  name : str
+    configuration name
+  edges : array
+    energy bin edges (MeV)
+  """
+  files = glob.glob("fom_%s_%s_nt_gamma*.csv"%(material,name))
+  rows  = [np.loadtxt(f,delimiter=",",comments="#",ndmin=2) for f in files]
+  rows  = [r for r in rows if r.size]
+  data  = np.concatenate(rows) if rows else np.zeros((0,8))
+  w,x   = data[:,0],data[:,1]
+  p     = np.sqrt(data[:,4]**2 + data[:,5]**2 + data[:,6]**2)
+  theta = np.degrees(np.arccos(np.clip(data[:,4]/np.where(p>0,p,1),-1,1)))
+
+  rear  = (abs(x - THICKNESS[material]) < 1) & (p > E0)
+  spectra = {}
+  for a in ANGLES:
+    tmin,tmax = max(a-A0,0),a+A0
+    domega = 2*np.pi*(np.cos(np.radians(tmin)) - np.cos(np.radians(tmax)))
+    ring = rear & (theta >= tmin) & (theta < tmax)
+    s,_  = np.histogram(p[ring],bins=edges,weights=w[ring])
+    s2,_ = np.histogram(p[ring],bins=edges,weights=w[ring]**2)
+    de   = np.diff(edges)
+    spectra[a] = (s/(de*domega), np.sqrt(s2)/(de*domega))
+  return spectra
+
+def score(simulated,experimental):
+  """
+  Return the reduced chi2 against experiment and the mean relative error of the
+  simulated spectra, over the bins with experimental data.
+
+  Parameters
+  ----------
+  simulated : dict
+    simulated spectra and errors per angle
+  experimental : dict
+    experimental spectra and errors per angle
+  """
+  chi2,ndf,relative = 0.,0,[]
+  for a in ANGLES:
+    s,ds = simulated[a]
+    e,de = experimental[a]
+    chi2 += np.sum((s-e)**2/(de**2 + ds**2))
+    ndf  += len(e)
+    relative += list(ds[s>0]/s[s>0]) + [1.]*int(np.sum(s<=0))
+  sigma = np.sqrt(np.mean(np.square(relative)))
+  return chi2/ndf,sigma
+
+if __name__ == "__main__":
+  if len(sys.argv) < 2 or sys.argv[1] not in THICKNESS:
+    print(__doc__)
+    sys.exit(1)
+  material = sys.argv[1]
+  events   = int(sys.argv[2]) if len(sys.argv) > 2 else 200000
+  threads  = int(sys.argv[3]) if len(sys.argv) > 3 else os.cpu_count()
+  limit    = float(sys.argv[4]) if len(sys.argv) > 4 else 2.
+  configs  = CONFIGS
+  if len(sys.argv) > 5:
+    with open(sys.argv[5]) as f:
+      configs = json.load(f)
+
+  os.chdir(os.path.dirname(os.path.abspath(__file__)))
+  edges,experimental = read_experiment(material)
+
+  print("Faddegon 1991 %s, %d events, %d threads\n"%(material,events,threads))
+  print("%16s %12s %12s %12s %14s"%("configuration","time (s)","chi2/ndf","sigma","FOM (1/s)"))
+
+  results = {}
+  for name,commands in configs.items():
+    for f in glob.glob("fom_%s_%s_nt_*"%(material,name)):
+      os.remove(f)
+    walltime   = run(make_macro(material,name,commands,events),threads)
+    chi2,sigma = score(read_spectra(material,name,edges),experimental)
+    fom = 1./(sigma**2*walltime)
+    results[name] = {"commands":commands,"wallTime":walltime,"chi2":chi2,"sigma":sigma,"fom":fom}
+    print("%16s %12.2f %12.3f %12.4f %14.4g"%(name,walltime,chi2,sigma,fom))
+
+  matching = [n for n in results if results[n]["chi2"] <= limit]
+  if matching:
+    best = max(matching,key=lambda n:results[n]["fom"])
+    print("\nCheapest configuration with chi2/ndf <= %g : %s"%(limit,best))
+  else:
+    print("\nNo configuration with chi2/ndf <= %g"%limit)
+
+  with open("fom_%s.json"%material,"w") as f:
+    json.dump({"material":material,"events":events,"threads":threads,"results":results},f,indent=2)
+  print("Results written in fom_%s.json"%material)
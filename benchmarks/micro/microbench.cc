@@ -0,0 +1,381 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file microbench.cc
+/// \brief Microbenchmarks of the gp3m2 hot paths
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "G4Event.hh"
+#include "G4StepPoint.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4Positron.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "Units.hh"
+#include "InputReader.hh"
+#include "Diagnostics.hh"
+#include "ResponseMatrix.hh"
+#include "EventScheduler.hh"
+#include "PerformanceReport.hh"
+#include "Telemetry.hh"
+#include "TraceRecorder.hh"
+#include "RunTallies.hh"
+#include "PrimaryGeneratorAction.hh"
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+  /**
+  \brief Result of a microbenchmark.
+  */
+  struct Result
+  {
+    std::string name; /**< \brief Benchmark name.*/
+    G4double value;   /**< \brief Median value over the repetitions.*/
+    std::string unit; /**< \brief Unit of the value.*/
+  };
+
+  /**
+  \brief Benchmark parameters, fixed by default so that the results of two commits can be compared.
+  */
+  struct Parameters
+  {
+    Parameters() : numberOfRows(200000), numberOfEvents(200000), numberOfRecords(200000),
+                   numberOfCalls(10000000), repetitions(5), directory("."), jsonFileName("") {};
+    G4int numberOfRows;       /**< \brief Number of rows of the synthetic input file.*/
+    G4int numberOfEvents;     /**< \brief Number of events generated.*/
+    G4int numberOfRecords;    /**< \brief Number of phase space records filled.*/
+    G4int numberOfCalls;      /**< \brief Number of unit conversions.*/
+    G4int repetitions;        /**< \brief Number of repetitions, the median is kept.*/
+    std::string directory;    /**< \brief Directory of the synthetic input and output files.*/
+    std::string jsonFileName; /**< \brief JSON result file, no file if empty.*/
+  };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the median wall time in s of several calls of a function.
+
+The function is called once before the measure, to warm up the caches.
+*/
+template<typename Function>
+G4double MedianTime(G4int repetitions, Function function)
+{
+  function();
+
+  std::vector<G4double> times;
+  for (G4int i=0; i<repetitions; i++)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    function();
+    times.push_back(std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size()/2];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write a synthetic input file with a fixed seed, and return its size in bytes.
+
+The rows have the format of the gp3m2 input files, with the default units.
+*/
+G4double WriteSyntheticInput(const std::string& fileName, G4int numberOfRows)
+{
+  std::mt19937 engine(12345);
+  std::uniform_real_distribution<G4double> uniform(-1., 1.);
+
+  std::ofstream output(fileName);
+  output << "# Synthetic input of the gp3m2 microbenchmarks" << std::endl;
+  output << "# weight x (um) y (um) z (um) px (MeV/c) py (MeV/c) pz (MeV/c) t (fs)" << std::endl;
+  output << std::scientific << std::setprecision(7);
+  for (G4int i=0; i<numberOfRows; i++)
+  {
+    output << std::setw(15) << 1.e7*(1.5 + uniform(engine))
+           << std::setw(16) << 1.5
+           << std::setw(16) << 10.*uniform(engine)
+           << std::setw(16) << 10.*uniform(engine)
+           << std::setw(16) << 5.*(1.1 + uniform(engine))
+           << std::setw(16) << 0.5*uniform(engine)
+           << std::setw(16) << 0.5*uniform(engine)
+           << std::setw(16) << 700. + 50.*uniform(engine) << std::endl;
+  }
+  output.close();
+
+  std::ifstream input(fileName, std::ios::binary | std::ios::ate);
+  return (G4double)input.tellg();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Measure the input file reading throughput.
+
+The file name is given again before each read, so that the macro-particles kept
+in memory are read again.
+*/
+void BenchmarkInputReader(const Parameters& parameters, Units* units, std::vector<Result>& results)
+{
+  std::string fileName = parameters.directory + "/microbench_input.dat";
+  G4double fileSize = WriteSyntheticInput(fileName, parameters.numberOfRows);
+
+  InputReader inputReader(units);
+  G4double time = MedianTime(parameters.repetitions, [&]() {
+    inputReader.SetInputFileName(fileName);
+    inputReader.ReadInputFile();
+  });
+
+  results.push_back({"input_read_throughput", fileSize/time/1.e6, "MB/s"});
+  results.push_back({"input_read_rows", parameters.numberOfRows/time, "rows/s"});
+  std::remove(fileName.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Measure the primary generation rate, from the synthetic input file.
+
+The generator uses the default random event scheduler, with the telemetry and
+the trace disabled as in a default run.
+*/
+void BenchmarkPrimaryGenerator(const Parameters& parameters, Units* units, std::vector<Result>& results)
+{
+  std::string fileName = parameters.directory + "/microbench_input.dat";
+  WriteSyntheticInput(fileName, parameters.numberOfRows);
+
+  InputReader* inputReader = new InputReader(units);
+  inputReader->SetInputFileName(fileName);
+  inputReader->SetParticleName("e-");
+  inputReader->ReadInputFile();
+  inputReader->NormalizeMacroParticlesWeights(parameters.numberOfEvents);
+
+  ResponseMatrix responseMatrix(units, nullptr);
+  EventScheduler eventScheduler;
+  PerformanceReport performanceReport;
+  Telemetry telemetry;
+  TraceRecorder traceRecorder;
+  RunTallies runTallies;
+  eventScheduler.BeginOfRun(0, 0);
+  eventScheduler.PrepareRun(inputReader, parameters.numberOfEvents);
+
+  PrimaryGeneratorAction generator(inputReader, &responseMatrix, &eventScheduler, &performanceReport,
+                                   &telemetry, &traceRecorder, &runTallies);
+
+  G4Random::setTheSeed(12345);
+  G4double time = MedianTime(parameters.repetitions, [&]() {
+    for (G4int i=0; i<parameters.numberOfEvents; i++)
+    {
+      G4Event event(i);
+      generator.GeneratePrimaries(&event);
+    }
+  });
+
+  results.push_back({"generate_primaries", parameters.numberOfEvents/time, "events/s"});
+  delete inputReader;
+  std::remove(fileName.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Measure the cost of a phase space record, with the compiled output backend.
+
+The backend is the one selected in Diagnostics.hh, its name is part of the
+result name. The records alternate between the three species.
+*/
+void BenchmarkDiagnostics(const Parameters& parameters, Units* units, std::vector<Result>& results)
+{
+  Diagnostics diagnostics(units);
+  diagnostics.SetOutputFileBaseName(parameters.directory + "/microbench_output");
+
+  const G4ParticleDefinition* species[3] = {G4Electron::Definition(), G4Gamma::Definition(), G4Positron::Definition()};
+  G4StepPoint stepPoint;
+  stepPoint.SetStepStatus(fGeomBoundary);
+  stepPoint.SetMomentumDirection(G4ThreeVector(1.,0.,0.));
+  stepPoint.SetWeight(1.e3);
+
+  G4double time = MedianTime(parameters.repetitions, [&]() {
+    diagnostics.InitializeAllDiags();
+    for (G4int i=0; i<parameters.numberOfRecords; i++)
+    {
+      const G4ParticleDefinition* particle = species[i%3];
+      stepPoint.SetMass(particle->GetPDGMass());
+      stepPoint.SetKineticEnergy((1. + i%1000)*keV);
+      stepPoint.SetPosition(G4ThreeVector(1.5*um, (i%97)*0.1*um, (i%89)*0.1*um));
+      stepPoint.SetGlobalTime((700. + i%50)*0.001*ps);
+      diagnostics.FillDiagSurfacePhaseSpace(particle, &stepPoint);
+    }
+    diagnostics.FinishAllDiags();
+  });
+
+  G4String backend = G4AnalysisManager::Instance()->GetType();
+  results.push_back({"fill_phase_space_" + backend, 1.e9*time/parameters.numberOfRecords, "ns/record"});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Measure the cost of the unit conversions, looked up by label at each call.
+
+*/
+void BenchmarkUnits(const Parameters& parameters, Units* units, std::vector<Result>& results)
+{
+  volatile G4double sink = 0.;
+  G4double time = MedianTime(parameters.repetitions, [&]() {
+    G4double sum = 0.;
+    for (G4int i=0; i<parameters.numberOfCalls; i++)
+    {
+      sum += units->GetPositionUnitValue() + units->GetMomentumUnitValue() + units->GetTimeUnitValue();
+    }
+    sink = sum;
+  });
+
+  results.push_back({"units_conversion", 1.e9*time/(3.*parameters.numberOfCalls), "ns/call"});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the results, and write them in a JSON file if asked.
+
+*/
+void WriteResults(const Parameters& parameters, const std::vector<Result>& results)
+{
+  G4cout << G4endl << std::setw(36) << std::left << "benchmark" << std::right
+         << std::setw(16) << "median" << "  unit" << G4endl;
+  for (const Result& result : results)
+  {
+    G4cout << std::setw(36) << std::left << result.name << std::right
+           << std::setw(16) << result.value << "  " << result.unit << G4endl;
+  }
+
+  if (parameters.jsonFileName == "") return;
+
+  std::ofstream output(parameters.jsonFileName);
+  output << "{" << std::endl;
+  output << "  \"parameters\": {\"rows\": " << parameters.numberOfRows
+         << ", \"events\": " << parameters.numberOfEvents
+         << ", \"records\": " << parameters.numberOfRecords
+         << ", \"calls\": " << parameters.numberOfCalls
+         << ", \"repetitions\": " << parameters.repetitions << "}," << std::endl;
+  output << "  \"results\": [";
+  for (size_t i=0; i<results.size(); i++)
+  {
+    output << (i == 0 ? "" : ",") << std::endl
+           << "    {\"name\": \"" << results[i].name << "\", \"value\": " << results[i].value
+           << ", \"unit\": \"" << results[i].unit << "\"}";
+  }
+  output << std::endl << "  ]" << std::endl << "}" << std::endl;
+  output.close();
+  G4cout << G4endl << "Results written in " << parameters.jsonFileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the command line usage.
+
+*/
+void PrintUsage()
+{
+  G4cerr << " Usage: " << G4endl;
+  G4cerr << " gp3m2_microbench [options]" << G4endl;
+  G4cerr << "   --rows N         : rows of the synthetic input file (200000)" << G4endl;
+  G4cerr << "   --events N       : events generated (200000)" << G4endl;
+  G4cerr << "   --records N      : phase space records filled (200000)" << G4endl;
+  G4cerr << "   --calls N        : unit conversions (10000000)" << G4endl;
+  G4cerr << "   --repetitions N  : repetitions, the median is kept (5)" << G4endl;
+  G4cerr << "   --dir path       : directory of the temporary files (.)" << G4endl;
+  G4cerr << "   --json file      : write the results in a JSON file" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Run the microbenchmarks of the input, generator, diagnostics and units hot paths.
+
+*/
+int main(int argc,char** argv)
+{
+  Parameters parameters;
+  for (G4int i=1; i<argc; i++)
+  {
+    std::string option = argv[i];
+    if (i+1 >= argc)
+    {
+      PrintUsage();
+      return 1;
+    }
+    std::string value = argv[++i];
+    if      (option == "--rows")        parameters.numberOfRows = std::atoi(value.c_str());
+    else if (option == "--events")      parameters.numberOfEvents = std::atoi(value.c_str());
+    else if (option == "--records")     parameters.numberOfRecords = std::atoi(value.c_str());
+    else if (option == "--calls")       parameters.numberOfCalls = std::atoi(value.c_str());
+    else if (option == "--repetitions") parameters.repetitions = std::max(1, std::atoi(value.c_str()));
+    else if (option == "--dir")         parameters.directory = value;
+    else if (option == "--json")        parameters.jsonFileName = value;
+    else
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  // define the particles, before the input reader looks them up by name
+  G4Electron::Definition();
+  G4Gamma::Definition();
+  G4Positron::Definition();
+
+  Units* units = new Units();
+  std::vector<Result> results;
+
+  BenchmarkInputReader(parameters, units, results);
+  BenchmarkPrimaryGenerator(parameters, units, results);
+  BenchmarkDiagnostics(parameters, units, results);
+  BenchmarkUnits(parameters, units, results);
+
+  WriteResults(parameters, results);
+
+  delete units;
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
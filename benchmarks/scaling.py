@@ -0,0 +1,83 @@
+#coding:utf8
+"""
+Strong scaling of gp3m2 with the number of threads.
+
+Run a benchmark macro with an increasing number of threads, read the scaling
+line printed by the master at the end of the run, and print the speed-up and
+the parallel efficiency with respect to the single thread run.
+
+Usage (from the root dir) :
+  python3 benchmarks/scaling.py [benchmark] [maxThreads] [runManagerType] [eventsPerTask]
+"""
+
+import os
+import re
+import sys
+import subprocess
+
+SRC   = "../../build/gp3m2"
+MACRO = "run.mac"
+
+def thread_counts(nmax):
+  """
+  Return the list of thread numbers to test, powers of 2 up to nmax.
+
+  Parameters
+  ----------
+  nmax : int
+    maximum number of threads
+  """
+  counts = []
+  n = 1
+  while n < nmax:
+    counts.append(n)
+    n *= 2
+  counts.append(nmax)
+  return counts
+
+def run(nthreads,rmtype,modulo):
+  """
+  Launch the macro with a given number of threads and return the wall time
+  and event rate of the last run.
+
+  The number of threads is forced with the Geant4 environment variable
+  G4FORCENUMBEROFTHREADS, so that /run/numberOfThreads in the macro is ignored.
+
+  Parameters
+  ----------
+  nthreads : int
+    number of threads
+  rmtype : str
+    run manager type (serial, mt or tasking)
+  modulo : int
+    number of events per task
+  """
+  env = dict(os.environ)
+  env["G4FORCENUMBEROFTHREADS"] = str(nthreads)
+  cmd = [SRC,"-r",rmtype,"-t",str(nthreads),"-e",str(modulo),"-m",MACRO]
+  out = subprocess.run(cmd,env=env,stdout=subprocess.PIPE,
+                       stderr=subprocess.STDOUT,universal_newlines=True).stdout
+  res = re.findall(r"scaling : (\d+) events ; (\d+) threads ; wall time ([\d.e+-]+) s ; ([\d.e+-]+) events/s",out)
+  if not res:
+    print(out)
+    raise RuntimeError("No scaling report found for %d threads"%nthreads)
+  nevents,nt,walltime,rate = res[-1]
+  return float(walltime),float(rate)
+
+if __name__ == "__main__":
+  bench  = sys.argv[1] if len(sys.argv) > 1 else "1"
+  nmax   = int(sys.argv[2]) if len(sys.argv) > 2 else os.cpu_count()
+  rmtype = sys.argv[3] if len(sys.argv) > 3 else "tasking"
+  modulo = int(sys.argv[4]) if len(sys.argv) > 4 else 1
+
+  os.chdir(os.path.join(os.path.dirname(os.path.abspath(__file__)),bench))
+
+  print("Benchmark %s, %s run manager, %d events per task\n"%(bench,rmtype,modulo))
+  print("%8s %12s %14s %10s %10s"%("threads","time (s)","events/s","speed-up","efficiency"))
+
+  t1 = None
+  for n in thread_counts(nmax):
+    walltime,rate = run(n,rmtype,modulo)
+    if t1 is None: t1 = walltime
+    speedup = t1/walltime
+    print("%8d %12.3f %14.1f %10.2f %9.1f%%"%(n,walltime,rate,speedup,100.*speedup/n))
@@ -0,0 +1,133 @@
+#coding:utf8
+"""
+Check the merging of the run tallies between the threads.
+
+Run a workload of benchmarks/throughput once with the serial run manager and
+once with several threads, with the same event seed (/scheduler/setEventSeed)
+so that each event is the same whatever the thread processing it, and compare
+the run summaries written by the master : the number of events and primaries
+and the recorded counts must be equal, and the weights and energy fluxes equal
+to the rounding of the sums.
+
+Usage (from the root dir) :
+  python3 benchmarks/summary.py [workload] [threads] [runManagerType] [rtol]
+"""
+
+import os
+import sys
+import subprocess
+
+SRC = "../../build/gp3m2"
+
+def make_macro(workload,rmtype):
+  """
+  Write the macro of a workload with an event seed and a summary file, and
+  return its name.
+
+  Parameters
+  ----------
+  workload : str
+    workload name, i.e. macro file name without extension
+  rmtype : str
+    run manager type (serial, mt or tasking)
+  """
+  with open(workload+".mac") as f:
+    lines = [l.rstrip("\n") for l in f]
+
+  macro = []
+  for l in lines:
+    if l.startswith("/summary/setFileName") or l.startswith("/diags/setFileBaseName"):
+      continue
+    if l.startswith("/run/beamOn"):
+      macro += ["/scheduler/setEventSeed 12345",
+                "/diags/setFileBaseName summary_%s"%rmtype,
+                "/summary/setFileName summary_%s.txt"%rmtype]
+    macro.append(l)
+
+  filename = "summary_%s.mac"%rmtype
+  with open(filename,"w") as f:
+    f.write("\n".join(macro) + "\n")
+  return filename
+
+def read_summary(filename):
+  """
+  Return the header values and the tallies per (interface, species) of a run
+  summary.
+
+  Parameters
+  ----------
+  filename : str
+    summary file name
+  """
+  with open(filename) as f:
+    rows = [l.split() for l in f if l.strip() and not l.startswith("#")]
+  header = (int(rows[0][0]),int(rows[0][1]),float(rows[0][2]))
+  cells  = {(int(r[0]),r[1]) : (int(r[2]),float(r[3]),float(r[4])) for r in rows[1:]}
+  return header,cells
+
+def run(workload,nthreads,rmtype):
+  """
+  Launch a workload and return its run summary.
+
+  Parameters
+  ----------
+  workload : str
+    workload name
+  nthreads : int
+    number of threads
+  rmtype : str
+    run manager type (serial, mt or tasking)
+  """
+  if os.path.exists("summary_%s.txt"%rmtype):
+    os.remove("summary_%s.txt"%rmtype)
+  env = dict(os.environ)
+  env["G4FORCENUMBEROFTHREADS"] = str(nthreads)
+  cmd = [SRC,"-r",rmtype,"-t",str(nthreads),"-m",make_macro(workload,rmtype)]
+  out = subprocess.run(cmd,env=env,stdout=subprocess.PIPE,
+                       stderr=subprocess.STDOUT,universal_newlines=True).stdout
+  if not os.path.exists("summary_%s.txt"%rmtype):
+    print(out[-2000:])
+    raise RuntimeError("No run summary written by the %s run"%rmtype)
+  return read_summary("summary_%s.txt"%rmtype)
+
+def close(a,b,rtol):
+  """
+  Return True if two values are equal within a relative tolerance.
+
+  Parameters
+  ----------
+  a, b : float
+    values
+  rtol : float
+    relative tolerance
+  """
+  return abs(a-b) <= rtol*max(abs(a),abs(b))
+
+if __name__ == "__main__":
+  workload = sys.argv[1] if len(sys.argv) > 1 else "converter"
+  nthreads = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+  rmtype   = sys.argv[3] if len(sys.argv) > 3 else "tasking"
+  rtol     = float(sys.argv[4]) if len(sys.argv) > 4 else 1e-9
+
+  os.chdir(os.path.join(os.path.dirname(os.path.abspath(__file__)),"throughput"))
+
+  print("Workload %s, serial vs %s run manager with %d threads\n"%(workload,rmtype,nthreads))
+  (ref,refcells) = run(workload,1,"serial")
+  (new,newcells) = run(workload,nthreads,rmtype)
+
+  errors = []
+  if ref[:2] != new[:2] or not close(ref[2],new[2],rtol):
+    errors.append("events, primaries, weight : serial %s, %s %s"%(ref,rmtype,new))
+  if new[1] == 0:
+    errors.append("no primary in the %s summary"%rmtype)
+  for key in sorted(set(refcells)|set(newcells)):
+    r = refcells.get(key,(0,0.,0.))
+    n = newcells.get(key,(0,0.,0.))
+    if r[0] != n[0] or not close(r[1],n[1],rtol) or not close(r[2],n[2],rtol):
+      errors.append("interface %d %s : serial %s, %s %s"%(key[0],key[1],r,rmtype,n))
+
+  print("%d events, %d primaries, %d tallies compared"%(new[0],new[1],len(newcells)))
+  for e in errors:
+    print(e)
+  print("\nSummaries %s"%("differ" if errors else "match"))
+  sys.exit(1 if errors else 0)
@@ -0,0 +1,171 @@
+#coding:utf8
+"""
+End-to-end throughput and thread scaling of gp3m2 on reference workloads.
+
+Each workload (vacuum.mac, stack.mac and converter.mac) is run with fixed seeds
+at 1, 2, 4 ... N threads. The wall time and event rate are read from the
+scaling line printed by the master, the peak resident memory is given by the
+kernel for the gp3m2 process, and the output size is the size of the phase
+space files. The results are written in a JSON file, which can be compared with
+a baseline to flag regressions.
+
+Usage (from the root dir) :
+  python3 benchmarks/throughput/throughput.py record output.json [maxThreads] [runManagerType]
+  python3 benchmarks/throughput/throughput.py compare baseline.json current.json [tolerance]
+"""
+
+import os
+import re
+import sys
+import glob
+import json
+import platform
+import subprocess
+
+sys.path.insert(0,os.path.join(os.path.dirname(os.path.abspath(__file__)),".."))
+from scaling import thread_counts
+
+SRC       = "../../build/gp3m2"
+WORKLOADS = ["vacuum","stack","converter"]
+
+def run(workload,nthreads,rmtype):
+  """
+  Launch a workload with a given number of threads and return its measures.
+
+  The process is waited with os.wait4 to get its own peak resident memory.
+
+  Parameters
+  ----------
+  workload : str
+    workload name, i.e. macro file name without extension
+  nthreads : int
+    number of threads
+  rmtype : str
+    run manager type (serial, mt or tasking)
+  """
+  for name in glob.glob("%s_nt_*"%workload):
+    os.remove(name)
+
+  env = dict(os.environ)
+  env["G4FORCENUMBEROFTHREADS"] = str(nthreads)
+  cmd = [SRC,"-r",rmtype,"-t",str(nthreads),"-m",workload+".mac"]
+  with open(workload+".log","w") as log:
+    process = subprocess.Popen(cmd,env=env,stdout=log,stderr=subprocess.STDOUT)
+    pid,status,rusage = os.wait4(process.pid,0)
+    process.returncode = status
+
+  with open(workload+".log") as log:
+    out = log.read()
+  res = re.findall(r"scaling : (\d+) events ; (\d+) threads ; wall time ([\d.e+-]+) s ; ([\d.e+-]+) events/s",out)
+  if status != 0 or not res:
+    print(out[-2000:])
+    raise RuntimeError("Workload %s failed with %d threads"%(workload,nthreads))
+  nevents,nt,walltime,rate = res[-1]
+
+  return {"threads"     : nthreads,
+          "events"      : int(nevents),
+          "wallTime"    : float(walltime),
+          "eventRate"   : float(rate),
+          "peakRSS"     : rusage.ru_maxrss*1024,
+          "outputBytes" : sum(os.path.getsize(f) for f in glob.glob("%s_nt_*"%workload))}
+
+def record(output,nmax,rmtype):
+  """
+  Run all the workloads at all the thread numbers and write the results.
+
+  Parameters
+  ----------
+  output : str
+    JSON output file name
+  nmax : int
+    maximum number of threads
+  rmtype : str
+    run manager type (serial, mt or tasking)
+  """
+  output = os.path.abspath(output)
+  os.chdir(os.path.dirname(os.path.abspath(__file__)))
+
+  results = {"host"      : platform.node(),
+             "cpus"      : os.cpu_count(),
+             "runManager": rmtype,
+             "workloads" : {}}
+
+  print("%10s %8s %12s %14s %10s %12s %12s"%("workload","threads","time (s)","events/s","efficiency","RSS (MB)","output (MB)"))
+  for workload in WORKLOADS:
+    runs = []
+    for n in thread_counts(nmax):
+      r = run(workload,n,rmtype)
+      r["efficiency"] = r["eventRate"]/(n*runs[0]["eventRate"]) if runs else 1.
+      runs.append(r)
+      print("%10s %8d %12.3f %14.1f %9.1f%% %12.1f %12.1f"%(workload,n,r["wallTime"],r["eventRate"],
+            100.*r["efficiency"],r["peakRSS"]/1e6,r["outputBytes"]/1e6))
+    results["workloads"][workload] = runs
+
+  with open(output,"w") as f:
+    json.dump(results,f,indent=2)
+  print("\nResults written in %s"%output)
+  return 0
+
+def compare(baseline,current,tolerance):
+  """
+  Compare two result files and flag the regressions.
+
+  A regression is an event rate lower, or a peak resident memory higher, than
+  the baseline by more than the relative tolerance. The output size must not
+  change, since the seeds are fixed. Return 1 if a regression is found.
+
+  Parameters
+  ----------
+  baseline : str
+    JSON file of the reference results
+  current : str
+    JSON file of the new results
+  tolerance : float
+    relative tolerance
+  """
+  with open(baseline) as f:
+    ref = json.load(f)
+  with open(current) as f:
+    new = json.load(f)
+
+  if ref.get("host") != new.get("host"):
+    print("Warning : results from different hosts (%s, %s)\n"%(ref.get("host"),new.get("host")))
+
+  print("%10s %8s %14s %14s %9s %9s  %s"%("workload","threads","ref events/s","new events/s","rate","RSS","status"))
+  regressions = 0
+  for workload,runs in sorted(new["workloads"].items()):
+    refruns = {r["threads"]:r for r in ref["workloads"].get(workload,[])}
+    for r in runs:
+      if r["threads"] not in refruns:
+        continue
+      b = refruns[r["threads"]]
+      rate = r["eventRate"]/b["eventRate"]-1.
+      rss  = float(r["peakRSS"])/b["peakRSS"]-1.
+      flags = []
+      if rate < -tolerance:
+        flags.append("SLOWER")
+      elif rate > tolerance:
+        flags.append("faster")
+      if rss > tolerance:
+        flags.append("MORE MEMORY")
+      if r["outputBytes"] != b["outputBytes"]:
+        flags.append("OUTPUT CHANGED")
+      if any(flag.isupper() for flag in flags):
+        regressions += 1
+      print("%10s %8d %14.1f %14.1f %+8.1f%% %+8.1f%%  %s"%(workload,r["threads"],b["eventRate"],r["eventRate"],
+            100.*rate,100.*rss,", ".join(flags) if flags else "OK"))
+
+  print("\n%d regression(s) with a tolerance of %g %%"%(regressions,100.*tolerance))
+  return 1 if regressions else 0
+
+if __name__ == "__main__":
+  if len(sys.argv) >= 3 and sys.argv[1] == "record":
+    nmax   = int(sys.argv[3]) if len(sys.argv) > 3 else os.cpu_count()
+    rmtype = sys.argv[4] if len(sys.argv) > 4 else "tasking"
+    sys.exit(record(sys.argv[2],nmax,rmtype))
+  elif len(sys.argv) >= 4 and sys.argv[1] == "compare":
+    tolerance = float(sys.argv[4]) if len(sys.argv) > 4 else 0.05
+    sys.exit(compare(sys.argv[2],sys.argv[3],tolerance))
+  else:
+    print(__doc__)
+    sys.exit(1)
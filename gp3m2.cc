@@ -29,6 +29,11 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+#include "G4Version.hh"
+#if G4VERSION_NUMBER >= 1070
+#include "G4RunManagerFactory.hh"
+#endif
+#include "G4RunManager.hh"
 #include "G4MTRunManager.hh"
 
 #include "G4UImanager.hh"
@@ -40,28 +45,133 @@
 #include "PhysicsList.hh"
 #include "ActionInitialization.hh"
 
+#include <cstdlib>
+#include <cstdio>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the command line usage.
+
+*/
+void PrintUsage()
+{
+  G4cerr << " Usage: " << G4endl;
+  G4cerr << " gp3m2 [options] -i        :"
+         << " launch the application in interactive mode (default)" << G4endl;
+  G4cerr << " gp3m2 [options] -v        :"
+         << " launch the application in visualization mode (default)" << G4endl;
+  G4cerr << " gp3m2 [options] -m macro  :"
+         << " launch the macro file `macro`" << G4endl;
+  G4cerr << G4endl;
+  G4cerr << " Options: " << G4endl;
+  G4cerr << " -r type  :"
+         << " run manager type, `serial`, `mt` (default) or `tasking`" << G4endl;
+  G4cerr << " -t N     :"
+         << " number of worker threads (or size of the thread pool)" << G4endl;
+  G4cerr << " -e N     :"
+         << " number of events per task (event modulo)" << G4endl;
+  G4cerr << " --shard i/N :"
+         << " run the shard i (from 0 to N-1) of a run split in N processes" << G4endl;
+  G4cerr << " --resume    :"
+         << " resume /checkpoint/beamOn from the checkpoint file" << G4endl;
+  G4cerr << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Create the run manager of the given type.
+
+Fall back to the multi-threaded run manager when the task-based one is not
+available in this Geant4 version.
+*/
+G4RunManager* CreateRunManager(const G4String& type)
+{
+#if G4VERSION_NUMBER >= 1070
+  if (type=="serial")  return G4RunManagerFactory::CreateRunManager(G4RunManagerType::Serial);
+  if (type=="tasking") return G4RunManagerFactory::CreateRunManager(G4RunManagerType::Tasking);
+  return G4RunManagerFactory::CreateRunManager(G4RunManagerType::MT);
+#else
+  if (type=="serial") return new G4RunManager;
+  if (type=="tasking")
+    G4cerr << "Task-based run manager requires Geant4 10.7 or later, mt is used" << G4endl;
+  return new G4MTRunManager;
+#endif
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 int main(int argc,char** argv)
 {
-  // construct the default run manager
-  G4MTRunManager* runManager = new G4MTRunManager;
+  // parse the command line
+  G4String mode = "-v";
+  G4String macro = "";
+  G4String runManagerType = "mt";
+  G4int numberOfThreads = 0;
+  G4int eventsPerTask = 0;
+  G4int shardIndex = 0;
+  G4int numberOfShards = 1;
+  G4bool resume = false;
+  for (G4int i=1;i<argc;i++)
+  {
+    G4String arg = argv[i];
+    G4bool hasValue = (i+1<argc);
+    if      (arg=="-i" or arg=="-v")    mode = arg;
+    else if (arg=="-m" and hasValue)    {mode = arg; macro = argv[++i];}
+    else if (arg=="-r" and hasValue)    runManagerType = argv[++i];
+    else if (arg=="-t" and hasValue)    numberOfThreads = std::atoi(argv[++i]);
+    else if (arg=="-e" and hasValue)    eventsPerTask = std::atoi(argv[++i]);
+    else if (arg=="--resume")           resume = true;
+    else if (arg=="--shard" and hasValue and
+             std::sscanf(argv[i+1], "%d/%d", &shardIndex, &numberOfShards)==2)
+      i++;
+    else
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if ((runManagerType!="serial" and runManagerType!="mt" and runManagerType!="tasking") or
+      shardIndex<0 or shardIndex>=numberOfShards)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  // construct the run manager
+  G4RunManager* runManager = CreateRunManager(runManagerType);
+
+  // default threads and events per task, macros can still change them with
+  // /run/numberOfThreads and /run/eventModulo
+  G4MTRunManager* mtRunManager = dynamic_cast<G4MTRunManager*>(runManager);
+  if (mtRunManager)
+  {
+    if (numberOfThreads>0) mtRunManager->SetNumberOfThreads(numberOfThreads);
+    if (eventsPerTask>0)   mtRunManager->SetEventModulo(eventsPerTask);
+  }
 
   Units* units = new Units();
 
   // set mandatory initialization classes
-  runManager->SetUserInitialization(new DetectorConstruction(units));
+  DetectorConstruction* detector = new DetectorConstruction(units);
+  runManager->SetUserInitialization(detector);
   runManager->SetUserInitialization(new PhysicsList);
 
   // set user action classes
-  runManager->SetUserInitialization(new ActionInitialization(units));
+  ActionInitialization* actionInitialization = new ActionInitialization(units, detector);
+  actionInitialization->SetShard(shardIndex, numberOfShards);
+  runManager->SetUserInitialization(actionInitialization);
 
   // get the pointer to the User Interface manager
   G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
+  // skip the segments already done by an interrupted run
+  if (resume) UImanager->ApplyCommand("/checkpoint/setResume true");
+
   // launch the app with the choosen mode
-  G4String mode = argv[1];
-  if (mode=="-v" or argc==1)               // visualization mode (default)
+  if (mode=="-v" or mode=="-i")      // visualization mode (default)
   {
     // initialize interactive session and visualization
     G4VisManager* visManager = new G4VisExecutive;
@@ -73,28 +183,12 @@ int main(int argc,char** argv)
     delete ui;
     delete visManager;
   }
-  else if (mode=="-m" and argc==3)   // launch a macro
+  else                               // launch a macro
   {
     // launch the macro file
     G4String command = "/control/execute ";
-    G4String macro = argv[2];
     UImanager->ApplyCommand(command+macro);
   }
-  else
-  {
-    // print usage
-    G4cerr << " Usage: " << G4endl;
-    G4cerr << " gp3m2 -i        :"
-           << " launch the application in interactive mode (default)" << G4endl;
-    G4cerr << " gp3m2 -v        :"
-           << " launch the application in visualization mode (default)" << G4endl;
-    G4cerr << " gp3m2 -m macro  :"
-           << " launch the macro file `macro`" << G4endl;
-    G4cerr << G4endl;
-
-    // return error code
-    return 1;
-  }
 
   // job termination
   delete runManager;
@@ -35,6 +35,16 @@
 #include "G4VUserActionInitialization.hh"
 
 class Units;
+class DetectorConstruction;
+class WeightWindows;
+class ResponseMatrix;
+class EventScheduler;
+class Checkpoint;
+class AdaptiveStopping;
+class PerformanceReport;
+class Telemetry;
+class TraceRecorder;
+class ThreadPlacement;
 
 /**
 \brief Instanciate user classes in master or worker threads
@@ -44,18 +54,33 @@ This class is instanciated only once
 class ActionInitialization : public G4VUserActionInitialization
 {
   public:
-    ActionInitialization(Units* units);
+    ActionInitialization(Units* units, DetectorConstruction* detector);
     virtual ~ActionInitialization();
 
     // base class methods
     virtual void BuildForMaster() const;
     virtual void Build() const;
 
+    // set methods
+    void SetShard(G4int shardIndex, G4int numberOfShards);
+
   private:
     // Geant4 pointers
     // User pointers
     Units* fUnits;
+    DetectorConstruction* fDetector;
+    WeightWindows* fWeightWindows;
+    ResponseMatrix* fResponseMatrix;
+    EventScheduler* fEventScheduler;
+    Checkpoint* fCheckpoint;
+    AdaptiveStopping* fAdaptiveStopping;
+    PerformanceReport* fPerformanceReport;
+    Telemetry* fTelemetry;
+    TraceRecorder* fTraceRecorder;
+    ThreadPlacement* fThreadPlacement;
     // User variables
+    G4int fShardIndex;
+    G4int fNumberOfShards;
 };
 
 #endif
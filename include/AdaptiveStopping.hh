@@ -0,0 +1,107 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file AdaptiveStopping.hh
+/// \brief Definition of the AdaptiveStopping class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef AdaptiveStopping_h
+#define AdaptiveStopping_h 1
+
+#include "globals.hh"
+#include "G4Timer.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+class RunTallies;
+
+/**
+\brief Stop a segmented run when the observables reach a target precision or when the time budget is spent.
+
+This class is shared and instanciated only once. During a segmented run, each
+thread gives its run tallies at the end of each segment. Each (segment,thread)
+pair is an independent batch of primaries, from which the relative error of the
+recorded weight of the selected observables is estimated. After each segment,
+the run is stopped if the largest relative error is below the target precision,
+or if the next segment would exceed the time budget.
+*/
+class AdaptiveStopping
+{
+  public:
+    AdaptiveStopping();
+    ~AdaptiveStopping();
+
+    // user methods
+    void Start();
+    void AddThreadBatch(const RunTallies& tallies);
+    G4bool IsDone(G4int numberOfSegmentsDone);
+    void Finish();
+
+    // get/set methods
+    G4bool IsActive() const {return fPrecision > 0. || fTimeBudget > 0.;};
+
+    void AddObservable(G4int interfaceIndex, G4String particleName);
+    void ClearObservables() {fObservables.clear();};
+
+    void SetCommands();
+
+  private:
+    G4double GetRelativeError(G4int observableIndex) const;
+    G4double GetMaximumRelativeError() const;
+
+    /**
+    \brief Recorded weight at one interface, for one species or all of them.
+    */
+    struct Observable
+    {
+      Observable(G4int i, const G4String& name) : interfaceIndex(i), particleName(name), sum(0.), sumOfSquares(0.) {};
+      G4int interfaceIndex;  /**< \brief Layer entered by the particle, -1 for the world.*/
+      G4String particleName; /**< \brief Particle name, or all for all the species.*/
+      G4double sum;          /**< \brief Sum of the batch weights.*/
+      G4double sumOfSquares; /**< \brief Sum of the squared batch weights divided by the batch sizes.*/
+    };
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+
+    // User pointers
+    // User variables
+    G4double fPrecision; /**< \brief Target relative error of the observables, 0 for none.*/
+    G4double fTimeBudget; /**< \brief Maximum wall time of the segmented run, 0 for none.*/
+    G4int fMinimumBatches; /**< \brief Minimum number of batches before the precision is trusted.*/
+
+    G4bool fRunning; /**< \brief True during an adaptive segmented run.*/
+    G4Timer fTimer; /**< \brief Wall time of the segmented run.*/
+    std::vector<Observable> fObservables; /**< \brief Selected observables and their batch sums.*/
+    G4int fNumberOfBatches; /**< \brief Number of (segment,thread) batches.*/
+    G4double fNumberOfPrimaries; /**< \brief Number of primaries of all the batches.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
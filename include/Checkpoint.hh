@@ -0,0 +1,104 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Checkpoint.hh
+/// \brief Definition of the Checkpoint class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef Checkpoint_h
+#define Checkpoint_h 1
+
+#include "globals.hh"
+
+#include <algorithm>
+
+class G4GenericMessenger;
+class AdaptiveStopping;
+
+/**
+\brief Split a long run in segments, and resume it after an interruption.
+
+This class is shared and instanciated only once. The events are processed as
+successive runs of a fixed number of events, each one writing its own output
+files. After each segment, the number of segments done and the state of the
+master engine, from which the worker seeds are generated, are saved, so that an
+interrupted run can be resumed at the first segment not done. The weights are
+normalized by the total number of events of all the segments. When the
+adaptive stopping criteria are set, the run may stop before the last segment,
+and the weights must then be renormalized to the number of events done, which
+is saved in the checkpoint file.
+
+The number of events used for the weight normalization is also given by this
+class for normal runs. It is set by the master, so that it does not depend on
+how the events are split between the threads.
+*/
+class Checkpoint
+{
+  public:
+    Checkpoint(AdaptiveStopping* adaptiveStopping);
+    ~Checkpoint();
+
+    // user methods
+    void BeamOn(G4int numberOfEvents, G4int eventsPerCheckpoint);
+    void BeginOfRun(G4int numberOfEvents) {fRunEvents = numberOfEvents;};
+
+    // get/set methods
+    G4bool IsActive() const {return fActive;};
+    G4int GetSegmentIndex() const {return fSegmentIndex;};
+    G4int GetFirstEventIndex() const {return fActive ? fSegmentIndex*fEventsPerCheckpoint : 0;};
+    G4int GetNormalizationEvents() const {return fActive ? fTotalEvents : fRunEvents;};
+
+    void SetShard(G4int shardIndex) {fShardSuffix = "_shard" + std::to_string(shardIndex);};
+
+    void SetCommands();
+
+  private:
+    G4int ReadCheckpoint(G4int numberOfEvents, G4int eventsPerCheckpoint);
+    void WriteCheckpoint(G4int numberOfSegmentsDone);
+    G4String GetFileName() const {return fFileName + fShardSuffix;};
+    G4int GetNumberOfEventsDone(G4int numberOfSegmentsDone) const {return std::min(fTotalEvents, numberOfSegmentsDone*fEventsPerCheckpoint);};
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+
+    // User pointers
+    AdaptiveStopping* fAdaptiveStopping; /**< \brief Pointer to the shared AdaptiveStopping instance.*/
+
+    // User variables
+    G4String fFileName; /**< \brief Checkpoint file name.*/
+    G4String fShardSuffix; /**< \brief Suffix of the checkpoint file in shard mode, empty otherwise.*/
+    G4bool fResume; /**< \brief True to resume the next segmented run from the checkpoint file.*/
+    G4bool fActive; /**< \brief True during a segmented run.*/
+    G4int fTotalEvents; /**< \brief Total number of events of the segmented run.*/
+    G4int fEventsPerCheckpoint; /**< \brief Number of events of each segment.*/
+    G4int fSegmentIndex; /**< \brief Index of the current segment.*/
+    G4int fRunEvents; /**< \brief Number of events of the current run, set by the master.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -35,8 +35,18 @@
 #include "G4VUserDetectorConstruction.hh"
 #include "globals.hh"
 
+#include "G4RotationMatrix.hh"
+#include "G4Cache.hh"
+
+#include <vector>
+#include <map>
+#include <set>
+
 class G4GenericMessenger;
+class G4Material;
+class G4VPhysicalVolume;
 class Units;
+class FastSimulationModel;
 
 /**
 \brief Construct geometry.
@@ -54,6 +64,14 @@ class DetectorConstruction : public G4VUserDetectorConstruction
 
     // user methods
     void AddTargetLayer(G4String materialName, G4double targetWidth);
+    void AddPeriodLayer(G4String materialName, G4double layerWidth);
+    void AddPeriodicStack(G4int numberOfPeriods);
+    void AddVoxelGrid(G4String fileName);
+    void ClearTarget();
+
+    void AttachFastSimulationModels();
+    void MergeFastSimulationCounts();
+    void PrintFastSimulationCounts();
 
     // get/set methods methods
     void SetTargetRadius(G4double targetRadius) {fTargetRadius = targetRadius * fUnits->GetPositionUnitValue();};
@@ -66,9 +84,32 @@ class DetectorConstruction : public G4VUserDetectorConstruction
       }
     }
 
+    void SetLayerImportance(G4int copyNumber, G4double importance);
+    G4double GetLayerImportance(G4int copyNumber) const {
+      return (copyNumber < (G4int)fLayerImportances.size()) ? fLayerImportances[copyNumber] : 1.;
+    }
+
+    void SetLayerRegion(G4String regionName) {
+      fLayerRegionName = (regionName == "none") ? "" : regionName;
+    }
+
+    void AddFastSimulationRegion(G4String regionName);
+
+    G4double GetTargetSizeLongi() const {return fTargetSizeLongi;};
+    G4String GetConfiguration() const;
+
+    static G4bool IsTargetVolume(const G4VPhysicalVolume* volume);
+    static G4bool IsVoxelVolume(const G4VPhysicalVolume* volume);
+
     void SetCommands();
 
   private:
+    void NotifyGeometryModified();
+    G4Material* GetMaterial(G4String materialName) const;
+    G4RotationMatrix* GetLayerRotation(const G4String& axis);
+    G4double GetLayerHalfExtent(G4double width, const G4String& axis) const;
+    G4bool CheckLayerOverlaps(G4double width, G4double halfExtent, G4double transverseHalfExtent) const;
+
     // Geant4 pointers
     G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
     G4LogicalVolume* fWorldLV; /**< \brief Pointer to the world logical volume.*/
@@ -81,7 +122,21 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4String fPropagationAxis; /**< \brief Particles propagation axis.*/
     G4double fTargetSizeLongi; /**< \brief Total target longitudinal size.*/
     G4double fTargetRadius; /**< \brief Target transverse size.*/
+    G4double fTargetExtentMax; /**< \brief Upper x bound of the volumes of the target, for overlaps checking.*/
+    G4String fLayerRegionName; /**< \brief Region of the next layers (world region if empty).*/
     G4bool fCheckOverlaps; /**< \brief Check if volumes are overlapping.*/
+    std::vector<G4double> fLayerImportances; /**< \brief Importance of each layer, indexed by copy number.*/
+    std::vector<G4String> fFastSimulationRegions; /**< \brief Regions whose layers are handled by a fast simulation model.*/
+    G4Cache<std::map<G4String,FastSimulationModel*>> fFastSimulationModels; /**< \brief Models attached by the current thread, per region.*/
+    std::map<G4String,G4long> fFastSimulationCounts; /**< \brief Number of particles handled per region, merged over the threads.*/
+    std::map<G4String,G4RotationMatrix*> fLayerRotations; /**< \brief Rotation shared by the layers, per propagation axis.*/
+    std::vector<G4Material*> fPeriodMaterials; /**< \brief Materials of the layers of the next periodic stack period.*/
+    std::vector<G4double> fPeriodWidths; /**< \brief Widths of the layers of the next periodic stack period.*/
+    G4double fVoxelDensityStep; /**< \brief Relative density step used to define the voxel materials.*/
+    std::vector<std::vector<size_t>> fVoxelMaterialIndices; /**< \brief Material index of each voxel, per voxel grid.*/
+
+    static std::set<const G4VPhysicalVolume*> fLayerVolumes; /**< \brief Physical volumes of the layers, placed, replicated or parameterised.*/
+    static std::set<const G4VPhysicalVolume*> fVoxelVolumes; /**< \brief Physical volumes of the voxels of the voxel grids.*/
 };
 
 #endif
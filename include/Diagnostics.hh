@@ -60,7 +60,7 @@ class Diagnostics
     void CreateDiagSurfacePhaseSpace();
 
     // methods to fill diagnostics
-    void FillDiagSurfacePhaseSpace(const G4ParticleDefinition* part, const G4StepPoint* stepPoint);
+    G4bool FillDiagSurfacePhaseSpace(const G4ParticleDefinition* part, const G4StepPoint* stepPoint);
 
     // methods to write output file
     void InitializeAllDiags();
@@ -70,6 +70,8 @@ class Diagnostics
     // get/set methods
     // methods to retrieve diag activation
     void SetOutputFileBaseName(G4String outputFileBaseName) {fOutputFileBaseName = outputFileBaseName;};
+    void SetShard(G4int shardIndex) {fShardSuffix = "_shard" + std::to_string(shardIndex);};
+    void SetSegment(G4int segmentIndex) {fSegmentSuffix = (segmentIndex < 0) ? "" : "_seg" + std::to_string(segmentIndex);};
 
     // methods to retrieve low and high energy limits
     G4double GetLowEnergyLimit() {return fLowEnergyLimit;};
@@ -88,9 +90,12 @@ class Diagnostics
 
     // User variables
     G4String fOutputFileBaseName; /**< \brief Output file base name.*/
+    G4String fShardSuffix; /**< \brief Suffix of the output files in shard mode, empty otherwise.*/
+    G4String fSegmentSuffix; /**< \brief Suffix of the output files of a segmented run, empty otherwise.*/
     G4double fLowEnergyLimit; /**< \brief Lower energy to fill diagnostics.*/
 
     G4bool fDiagSurfacePhaseSpaceActivation;
+    G4bool fNtuplesCreated; /**< \brief True once the Ntuples are created, as they are kept for the next runs.*/
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
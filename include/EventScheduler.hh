@@ -0,0 +1,131 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file EventScheduler.hh
+/// \brief Definition of the EventScheduler class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef EventScheduler_h
+#define EventScheduler_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+#include "G4Timer.hh"
+
+#include <vector>
+#include <map>
+
+class G4GenericMessenger;
+class InputReader;
+
+/**
+\brief Choose the input macro-particle of each event and measure the event times.
+
+This class is shared and instanciated only once. By default the macro-particles
+are picked at random. With cost ordering, each macro-particle is used exactly
+the expected number of times, and the most expensive ones are dispatched first
+so that all the workers finish together. The cost is first estimated from the
+kinetic energy, then refined with the measured event times per energy bin.
+
+With an event seed, the engine of each event is reseeded from the seed, the
+shard and the global event index, so that the events, and the macro-particles
+they pick, do not depend on the number of threads.
+*/
+class EventScheduler
+{
+  public:
+    EventScheduler();
+    ~EventScheduler();
+
+    // user methods
+    void BeginOfRun(G4int runKey, G4int firstEventIndex);
+    void SeedEvent(G4int eventID) const;
+    void PrepareRun(InputReader* inputReader, G4int numberOfPrimaries);
+    void NextMacroParticles(G4int numberOfMacroParticles, std::vector<G4int>& ids);
+    void MergeThreadTallies();
+    void EndOfRun(G4double wallTime);
+
+    // get/set methods
+    G4bool IsCostOrdering() const {return fCostOrdering;};
+
+    void SetShard(G4int shardIndex, G4int numberOfShards) {fShardIndex = shardIndex; fNumberOfShards = numberOfShards;};
+
+    void SetCommands();
+
+  private:
+    G4int PopMacroParticle();
+    void ScoreEventTime(const std::vector<G4int>& ids, G4double eventTime);
+    void SortRemainingMacroParticles();
+
+    /**
+    \brief Event timing of one thread.
+    */
+    struct Tallies
+    {
+      Tallies() : numberOfEvents(0), busyTime(0.) {};
+      G4Timer eventTimer;    /**< \brief Timer of the current event.*/
+      std::vector<G4int> currentIds; /**< \brief Macro-particles of the current event, empty if none.*/
+      G4long numberOfEvents; /**< \brief Number of events processed by the thread.*/
+      G4double busyTime;     /**< \brief Time spent in events by the thread (s).*/
+    };
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+
+    // User pointers
+    // User variables
+    G4bool fCostOrdering; /**< \brief True to dispatch the most expensive macro-particles first.*/
+    G4int fNumberOfEnergyBins; /**< \brief Number of logarithmic energy bins of the cost estimate.*/
+    G4int fReorderInterval; /**< \brief Number of primaries before the first refinement of the order.*/
+    G4int fEventSeed; /**< \brief Seed of the per-event engine states, 0 to keep the Geant4 seeding.*/
+
+    G4int fShardIndex; /**< \brief Index of the shard of this process.*/
+    G4int fNumberOfShards; /**< \brief Number of shards of the run.*/
+    G4int fRunKey; /**< \brief Run ID, or 0 during a segmented run whose event indices are global.*/
+    G4int fFirstEventIndex; /**< \brief Global index of the first event of the run.*/
+
+    G4bool fPrepared; /**< \brief True once the order of the current run is built.*/
+    std::vector<G4int> fOrder; /**< \brief Macro-particles sorted by decreasing cost.*/
+    std::vector<G4long> fRemaining; /**< \brief Number of primaries left for each macro-particle.*/
+    std::vector<G4int> fBins; /**< \brief Energy bin of each macro-particle.*/
+    std::vector<G4double> fEnergies; /**< \brief Kinetic energy of each macro-particle.*/
+    size_t fCursor; /**< \brief Position of the next macro-particle in fOrder.*/
+    G4long fNumberOfDispatched; /**< \brief Number of primaries dispatched in the current run.*/
+    G4long fNextReorder; /**< \brief Number of dispatched primaries of the next refinement.*/
+
+    std::vector<G4double> fBinTimes; /**< \brief Sum of measured primary times per energy bin.*/
+    std::vector<G4long> fBinCounts; /**< \brief Number of measured primaries per energy bin.*/
+    G4double fTotalTime; /**< \brief Sum of measured event times.*/
+    G4double fTotalEnergy; /**< \brief Sum of kinetic energies of the measured primaries.*/
+
+    G4Cache<Tallies> fThreadTallies; /**< \brief Event timing of the current thread.*/
+    std::map<G4int,std::pair<G4long,G4double>> fThreadReports; /**< \brief Number of events and busy time per thread id.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,107 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file FastSimulationModel.hh
+/// \brief Definition of the FastSimulationModel class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef FastSimulationModel_h
+#define FastSimulationModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4EmCalculator.hh"
+
+#include <vector>
+#include <map>
+
+class G4Material;
+class G4ParticleDefinition;
+
+/**
+\brief Approximate transport of e-, e+ and gamma through the layers of a region.
+
+Charged particles are moved straight to the layer exit, losing energy according to
+their CSDA range and being deflected with the Highland multiple scattering angle.
+Photons are transmitted without interaction with the narrow-beam attenuation
+probability, and absorbed otherwise. No secondaries are produced.
+
+The range and attenuation tables are computed once per material and per thread,
+so that each particle costs a few table lookups per layer.
+
+This class is instanciated in each worker thread.
+*/
+class FastSimulationModel : public G4VFastSimulationModel
+{
+  public:
+    FastSimulationModel(G4String modelName, G4Region* envelope);
+    ~FastSimulationModel();
+
+    // base class methods
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+    // get/set methods
+    G4long GetNumberOfCalls() const {return fNumberOfCalls;};
+    void ResetNumberOfCalls() {fNumberOfCalls = 0;};
+
+  private:
+    /**
+    \brief Precomputed tables of a material, on a logarithmic energy grid.
+    */
+    struct MaterialTables
+    {
+      std::vector<G4double> electronRange;    /**< \brief e- CSDA range.*/
+      std::vector<G4double> positronRange;    /**< \brief e+ CSDA range.*/
+      std::vector<G4double> gammaAttenuation; /**< \brief Gamma attenuation length.*/
+    };
+
+    const MaterialTables& GetTables(const G4Material* material);
+    std::vector<G4double> ComputeRangeTable(const G4ParticleDefinition* particle, const G4Material* material);
+    G4double GetTableValue(const std::vector<G4double>& table, G4double energy) const;
+    G4double GetEnergyFromRange(const std::vector<G4double>& range, G4double residualRange) const;
+
+    void DoItCharged(const G4FastTrack& fastTrack, G4FastStep& fastStep, G4double distance);
+    void DoItGamma(const G4FastTrack& fastTrack, G4FastStep& fastStep, G4double distance);
+
+    // Geant4 pointers
+    const G4ParticleDefinition* fElectron; /**< \brief Electron particle definition.*/
+    const G4ParticleDefinition* fPositron; /**< \brief Positron particle definition.*/
+    const G4ParticleDefinition* fGamma; /**< \brief Gamma particle definition.*/
+    G4EmCalculator fEmCalculator; /**< \brief Access to the EM cross sections and stopping powers.*/
+
+    // User variables
+    G4int fNumberOfBins; /**< \brief Number of points of the energy grid.*/
+    G4double fEnergyMin; /**< \brief Lowest energy of the grid.*/
+    G4double fEnergyMax; /**< \brief Highest energy of the grid.*/
+    G4long fNumberOfCalls; /**< \brief Number of particles handled by the model since the last reset.*/
+    std::map<const G4Material*,MaterialTables> fTables; /**< \brief Tables of the materials already met.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
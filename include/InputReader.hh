@@ -63,6 +63,14 @@ class InputReader
     G4int GetNumberOfMacroParticles() const {return fW.size();};
 
     G4String GetParticleName() {return fParticleName;};
+    G4ParticleDefinition* GetParticleDefinition() {
+      // Look the particle up once, the particle table may not be filled at construction
+      if (!fParticleDefinition) fParticleDefinition = G4ParticleTable::GetParticleTable()->FindParticle(fParticleName);
+      return fParticleDefinition;
+    }
+    G4int GetPrimariesPerEvent() const {return fPrimariesPerEvent;};
+
+    void SetShard(G4int shardIndex, G4int numberOfShards) {fShardIndex = shardIndex; fNumberOfShards = numberOfShards;};
 
     void SetInputFileName(G4String inputFileName) {
       // Define streams
@@ -72,6 +80,7 @@ class InputReader
       // Test if the input file exists
       if ((bool)input) {
         fInputFileName = inputFileName;
+        fLoadedFileName = "";
       } else {
         G4cerr << "Input file " << fInputFileName << " not found ..." << G4endl;
         throw;
@@ -85,12 +94,21 @@ class InputReader
       // Test if the table contains given input particle
       if (table->contains(particleName)) {
         fParticleName = particleName;
+        fParticleDefinition = table->FindParticle(particleName);
       } else {
         G4cerr << "Unknown primary particle : " << particleName << G4endl;
         throw;
       }
     }
 
+    void SetPrimariesPerEvent(G4int primariesPerEvent) {
+      if (primariesPerEvent > 0) {
+        fPrimariesPerEvent = primariesPerEvent;
+      } else {
+        G4cerr << "Invalid number of primaries per event : " << primariesPerEvent << G4endl;
+      }
+    }
+
     void SetCommands();
 
   private:
@@ -102,9 +120,15 @@ class InputReader
 
     // User variables
     G4String fInputFileName; /**< \brief Input file name.*/
+    G4String fLoadedFileName; /**< \brief Name of the file whose macro-particles are in memory.*/
     G4String fParticleName; /**< \brief Input particle name.*/
+    G4ParticleDefinition* fParticleDefinition; /**< \brief Input particle definition, looked up once.*/
+    G4int fPrimariesPerEvent; /**< \brief Number of primaries generated in each event.*/
+    G4int fShardIndex; /**< \brief Index of the shard of this process.*/
+    G4int fNumberOfShards; /**< \brief Number of shards, each one using a slice of the input rows.*/
 
     std::vector<G4double> fW,fX,fY,fZ,fPx,fPy,fPz,fT;  /**< \brief Arrays containing input macro-particles characteristics.*/
+    std::vector<G4double> fRawW; /**< \brief Input macro-particles weights, before normalization.*/
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
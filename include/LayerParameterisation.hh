@@ -0,0 +1,85 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file LayerParameterisation.hh
+/// \brief Definition of the LayerParameterisation class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef LayerParameterisation_h
+#define LayerParameterisation_h 1
+
+#include "G4VPVParameterisation.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4Material;
+class G4Tubs;
+class G4VPhysicalVolume;
+
+/**
+\brief Position, thickness and material of the layers of a periodic stack.
+
+The period is a sequence of coaxial layers repeated numberOfPeriods times along
+the z axis of the stack envelope, the layer of copy number i being the layer
+i % period of the period i / period. All the layers share the same solid, whose
+half length is updated for each copy.
+*/
+class LayerParameterisation : public G4VPVParameterisation
+{
+  public:
+    LayerParameterisation(const std::vector<G4Material*>& materials,
+                          const std::vector<G4double>& widths,
+                          G4int numberOfPeriods);
+    ~LayerParameterisation();
+
+    // base class methods
+    virtual void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const;
+    virtual void ComputeDimensions(G4Tubs& layerS, const G4int copyNo, const G4VPhysicalVolume* physVol) const;
+    virtual G4Material* ComputeMaterial(const G4int copyNo, G4VPhysicalVolume* physVol,
+                                        const G4VTouchable* parentTouch=nullptr);
+
+    // get/set methods
+    G4int GetNumberOfLayers() const {return fNumberOfPeriods * fWidths.size();};
+    G4double GetTotalWidth() const {return fNumberOfPeriods * fPeriodWidth;};
+    G4double GetMaximumWidth() const;
+    G4String GetConfiguration() const;
+
+  private:
+    // Geant4 pointers
+    std::vector<G4Material*> fMaterials; /**< \brief Materials of the layers of a period.*/
+
+    // User variables
+    std::vector<G4double> fWidths; /**< \brief Widths of the layers of a period.*/
+    std::vector<G4double> fCenters; /**< \brief Centers of the layers of a period, from the period start.*/
+    G4double fPeriodWidth; /**< \brief Total width of a period.*/
+    G4int fNumberOfPeriods; /**< \brief Number of periods in the stack.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
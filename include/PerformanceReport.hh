@@ -0,0 +1,120 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PerformanceReport.hh
+/// \brief Definition of the PerformanceReport class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef PerformanceReport_h
+#define PerformanceReport_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+
+#include <vector>
+#include <chrono>
+
+class G4GenericMessenger;
+class G4ParticleDefinition;
+
+/**
+\brief Count events, tracks, steps and records, and time them per layer and species.
+
+This class is shared and instanciated only once. The counters are accumulated
+per thread then merged at the end of the run, and the master prints a table and
+writes a JSON file. The report is disabled by default, as it reads the clock at
+each step. The step time is the time between two consecutive steps of a
+thread, given to the layer and species of the second one.
+*/
+class PerformanceReport
+{
+  public:
+    PerformanceReport();
+    ~PerformanceReport();
+
+    // user methods
+    void BeginOfRun();
+    void BeginGeneration();
+    void EndGeneration();
+    void ScoreStep(G4int layer, const G4ParticleDefinition* particle, G4bool newTrack);
+    void ScoreRecord();
+    void MergeThreadTallies();
+    void EndOfRun(G4double wallTime);
+
+    // get/set methods
+    G4bool IsEnabled() const {return fEnabled;};
+    void SetFileName(G4String fileName) {fFileName = (fileName == "none") ? "" : fileName;};
+    void SetShard(G4int shardIndex) {fShardSuffix = "_shard" + std::to_string(shardIndex);};
+
+    void SetCommands();
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    G4int GetSpeciesIndex(const G4ParticleDefinition* particle) const;
+    G4int GetCellIndex(G4int layer, G4int species) const {return (layer + 1) * fNumberOfSpecies + species;};
+    G4String GetLayerName(G4int cell) const;
+    void WriteJson(G4double wallTime) const;
+
+    /**
+    \brief Counters and times of one thread, or merged over all threads.
+    */
+    struct Tallies
+    {
+      Tallies() : numberOfEvents(0), numberOfTracks(0), numberOfRecords(0),
+                  generationTime(0.), fillTime(0.) {};
+      G4long numberOfEvents;  /**< \brief Number of events generated.*/
+      G4long numberOfTracks;  /**< \brief Number of tracks started.*/
+      G4long numberOfRecords; /**< \brief Number of phase space rows recorded at interfaces.*/
+      G4double generationTime;/**< \brief Time spent generating primaries (s).*/
+      G4double fillTime;      /**< \brief Time spent recording phase space rows (s).*/
+      std::vector<G4long> steps;       /**< \brief Number of steps per (layer,species) cell.*/
+      std::vector<G4double> stepTimes; /**< \brief Time spent per (layer,species) cell (s).*/
+      Clock::time_point generationStart; /**< \brief Start of the current generation.*/
+      Clock::time_point lastStamp;       /**< \brief End of the last generation, step or record.*/
+    };
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+    const G4ParticleDefinition* fElectron; /**< \brief Electron particle definition.*/
+    const G4ParticleDefinition* fGamma; /**< \brief Gamma particle definition.*/
+    const G4ParticleDefinition* fPositron; /**< \brief Positron particle definition.*/
+
+    // User pointers
+    // User variables
+    G4bool fEnabled; /**< \brief True if the steps are counted and timed.*/
+    G4int fNumberOfSpecies; /**< \brief Number of species columns (e-, gamma, e+ and others).*/
+    G4String fFileName; /**< \brief JSON output file, no file if empty.*/
+    G4String fShardSuffix; /**< \brief Suffix of the JSON file in shard mode, empty otherwise.*/
+
+    G4Cache<Tallies> fThreadTallies; /**< \brief Tallies of the current thread.*/
+    Tallies fMergedTallies; /**< \brief Tallies merged over all threads.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -33,6 +33,12 @@
 #define PhysicsList_h 1
 
 #include "G4VModularPhysicsList.hh"
+#include "G4VStateDependent.hh"
+#include "G4Timer.hh"
+#include "G4MscStepLimitType.hh"
+#include "G4ThreeVector.hh"
+
+#include <map>
 
 class G4VPhysicsConstructor;
 class G4GenericMessenger;
@@ -42,8 +48,11 @@ class G4GenericMessenger;
 /**
 \brief Define particles and processes to consider in the simulation.
 
+The physics tables can be stored in and retrieved from a cache directory. The
+class is notified of the master state changes to select the cache entry just
+before the tables are built at the beginning of a run.
 */
-class PhysicsList: public G4VModularPhysicsList
+class PhysicsList: public G4VModularPhysicsList, public G4VStateDependent
 {
   public:
     PhysicsList();
@@ -53,9 +62,21 @@ class PhysicsList: public G4VModularPhysicsList
     virtual void ConstructParticle();
     virtual void ConstructProcess();
     virtual void SetCuts();
+    virtual G4bool Notify(G4ApplicationState requestedState);
+
+    // user methods
+    G4String GetConfiguration() const;
 
   protected:
     void SetPhysicsList(G4String name);
+    void SetMscStepLimit(G4String regionName, G4String type);
+    void SetMscRangeFactor(G4String regionName, G4double factor);
+    void SetFluorescence(G4String regionName, G4bool fluorescence);
+    void SetAuger(G4String regionName, G4bool auger);
+    void SetLowestElectronEnergy(G4String regionName, G4double energy, G4String unit);
+    void SetBremSplitting(G4String regionName, G4int factor);
+    void ConstructRegionParameters();
+    G4String GetTableCacheKey() const;
     void SetCommands();
 
   private:
@@ -65,6 +86,21 @@ class PhysicsList: public G4VModularPhysicsList
 
     // User pointers
     // User variables
+    std::map<G4String,G4MscStepLimitType> fMscStepLimitTypes; /**< \brief Multiple scattering step limitation type per region.*/
+    std::map<G4String,G4double> fMscRangeFactors; /**< \brief Multiple scattering range factor per region.*/
+    std::map<G4String,G4bool> fFluorescence; /**< \brief Fluorescence activation per region.*/
+    std::map<G4String,G4bool> fAuger; /**< \brief Auger electron emission activation per region.*/
+    std::map<G4String,G4double> fLowestElectronEnergies; /**< \brief Lowest e-/e+ kinetic energy tracked per region.*/
+    std::map<G4String,G4int> fBremSplittingFactors; /**< \brief Bremsstrahlung splitting factor per region.*/
+    G4double fBremSplittingEnergyLimit; /**< \brief Bremsstrahlung photons above this energy are not split.*/
+    G4bool fDirectionalSplitting; /**< \brief Use directional instead of uniform bremsstrahlung splitting.*/
+    G4ThreeVector fDirectionalSplittingTarget; /**< \brief Center of the sphere of interest for directional splitting.*/
+    G4double fDirectionalSplittingRadius; /**< \brief Radius of the sphere of interest for directional splitting.*/
+    G4String fTableCacheDirectory; /**< \brief Physics tables cache directory (no cache if empty).*/
+    G4String fTableCacheEntry; /**< \brief Cache entry used for the tables of the current run.*/
+    G4bool fTableCacheHit; /**< \brief True if the tables of the current run are retrieved from the cache.*/
+    G4bool fTableCachePending; /**< \brief True between the cache entry selection and the end of the tables construction.*/
+    G4Timer fTableTimer; /**< \brief Timer of the physics tables construction.*/
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
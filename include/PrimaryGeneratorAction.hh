@@ -33,9 +33,17 @@
 #define PrimaryGeneratorAction_h 1
 
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "globals.hh"
+
+#include <vector>
 
-class G4ParticleTable;
 class InputReader;
+class ResponseMatrix;
+class EventScheduler;
+class PerformanceReport;
+class Telemetry;
+class TraceRecorder;
+class RunTallies;
 
 /**
 \brief Generate primary particles.
@@ -45,20 +53,29 @@ This class is instanciated in each worker thread.
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
   public:
-    PrimaryGeneratorAction(InputReader* inputReader);
+    PrimaryGeneratorAction(InputReader* inputReader, ResponseMatrix* responseMatrix,
+                           EventScheduler* eventScheduler, PerformanceReport* performanceReport,
+                           Telemetry* telemetry, TraceRecorder* traceRecorder,
+                           RunTallies* runTallies);
     ~PrimaryGeneratorAction();
 
     // base class methods
     virtual void GeneratePrimaries(G4Event*);
 
   private:
-    // Geant4 pointers
-    G4ParticleTable* fParticleTable;
+    void GenerateInputPrimaries(G4Event* anEvent);
 
     // User pointers
     InputReader* fInputReader;
+    ResponseMatrix* fResponseMatrix;
+    EventScheduler* fEventScheduler;
+    PerformanceReport* fPerformanceReport;
+    Telemetry* fTelemetry;
+    TraceRecorder* fTraceRecorder;
+    RunTallies* fRunTallies;
 
     // User variables
+    std::vector<G4int> fMacroParticleIds;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,139 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ResponseMatrix.hh
+/// \brief Definition of the ResponseMatrix class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ResponseMatrix_h
+#define ResponseMatrix_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+#include <unordered_map>
+
+class G4GenericMessenger;
+class G4ParticleDefinition;
+class G4Event;
+class G4Step;
+class Units;
+class DetectorConstruction;
+
+/**
+\brief Response of the target to incoming particles, tabulated on disk.
+
+The response matrix gives, for each incoming (species, energy, angle) bin, the
+mean weight of e-, gamma and e+ leaving each face of the target per outgoing
+(energy, angle) bin. It is built by a Geant4 run in build mode, and cached in a
+file whose name contains a hash of the target, physics and binning settings.
+A phase space can then be folded through the cached matrix instead of being
+transported.
+
+Angles are polar angles with respect to the +x axis, along which the layers
+are stacked. Incoming particles are sent at the center of the front face, so
+that the matrix does not depend on the transverse position of the particles.
+
+This class is shared and instanciated only once. The tallies are accumulated
+per thread then merged at the end of the run.
+*/
+class ResponseMatrix
+{
+  public:
+    ResponseMatrix(Units* units, DetectorConstruction* detector);
+    ~ResponseMatrix();
+
+    // user methods
+    void GeneratePrimaries(G4Event* anEvent);
+    void ScoreExit(const G4Step* aStep);
+
+    void BeginOfRun();
+    void MergeThreadTallies();
+    void EndOfRun();
+
+    void Fold(G4String inputFileName, G4String particleName);
+
+    // get/set methods
+    G4bool IsBuilding() const {return fBuilding;};
+
+    void SetNumberOfEnergyBins(G4int numberOfEnergyBins);
+    void SetEnergyMin(G4double energyMin);
+    void SetEnergyMax(G4double energyMax);
+    void SetNumberOfAngleBins(G4int numberOfAngleBins);
+
+    void SetCommands();
+
+  private:
+    G4String GetConfiguration() const;
+    G4String GetCacheFileName() const;
+    G4bool ReadCacheFile();
+
+    G4bool IsBinningLocked() const;
+
+    G4int GetSpeciesIndex(const G4ParticleDefinition* particle) const;
+    G4int GetEnergyBin(G4double energy) const;
+    G4int GetAngleBin(G4double theta, G4int numberOfAngleBins, G4double thetaMax) const;
+    G4int GetNumberOfIncomingBins() const {return 3 * fNumberOfEnergyBins * fNumberOfAngleBins;};
+    G4int GetNumberOfOutgoingBins() const {return 3 * 3 * fNumberOfEnergyBins * 2 * fNumberOfAngleBins;};
+
+    /**
+    \brief Response tallies of one thread.
+    */
+    struct Tallies
+    {
+      Tallies() : incomingBin(-1) {};
+      G4int incomingBin; /**< \brief Incoming bin of the current event.*/
+      std::vector<G4double> numberOfPrimaries; /**< \brief Number of primaries per incoming bin.*/
+      std::unordered_map<G4long,G4double> weights; /**< \brief Sum of outgoing weights per (incoming,outgoing) bin.*/
+    };
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+    const G4ParticleDefinition* fSpecies[3]; /**< \brief e-, gamma and e+ particle definitions.*/
+
+    // User pointers
+    Units* fUnits; /**< \brief Pointer to the Units instance.*/
+    DetectorConstruction* fDetector; /**< \brief Pointer to the shared DetectorConstruction instance.*/
+
+    // User variables
+    G4bool fBuilding; /**< \brief Build the response matrix during the next runs.*/
+    G4int fNumberOfEnergyBins; /**< \brief Number of logarithmic energy bins, for incoming and outgoing particles.*/
+    G4double fEnergyMin; /**< \brief Lower edge of the first energy bin.*/
+    G4double fEnergyMax; /**< \brief Upper edge of the last energy bin.*/
+    G4int fNumberOfAngleBins; /**< \brief Number of incoming angle bins in [0,pi/2], twice as much outgoing bins in [0,pi].*/
+    G4String fCacheDirectory; /**< \brief Directory of the response matrix files.*/
+    G4String fFoldFileName; /**< \brief Output file of the folded spectra.*/
+
+    G4Cache<Tallies> fThreadTallies; /**< \brief Tallies of the current thread.*/
+    Tallies fMergedTallies; /**< \brief Tallies merged over all threads, and over the previous builds.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
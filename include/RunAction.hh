@@ -34,22 +34,40 @@
 
 #include "G4UserRunAction.hh"
 #include "G4ThreeVector.hh"
+#include "G4Timer.hh"
+#include "RunTallies.hh"
 
 class G4Run;
 class G4ParticleDefinition;
 class Units;
+class DetectorConstruction;
 class InputReader;
 class Diagnostics;
+class WeightWindows;
+class ResponseMatrix;
+class EventScheduler;
+class Checkpoint;
+class AdaptiveStopping;
+class PerformanceReport;
+class Telemetry;
+class TraceRecorder;
+class ThreadPlacement;
 #include "G4GenericMessenger.hh"
 
 /**
 \brief Deal with input file reading and diagnostic creation.
 
+This class is instanciated in the master thread, without InputReader and
+Diagnostics, to merge the results of the worker threads.
 */
 class RunAction : public G4UserRunAction
 {
   public:
-    RunAction(Units* units, InputReader* inputReader, Diagnostics* diagnostics);
+    RunAction(Units* units, DetectorConstruction* detector, InputReader* inputReader, Diagnostics* diagnostics,
+              WeightWindows* weightWindows, ResponseMatrix* responseMatrix,
+              EventScheduler* eventScheduler, Checkpoint* checkpoint,
+              AdaptiveStopping* adaptiveStopping, PerformanceReport* performanceReport,
+              Telemetry* telemetry, TraceRecorder* traceRecorder, ThreadPlacement* threadPlacement);
     ~RunAction();
 
     // base class methods
@@ -60,16 +78,42 @@ class RunAction : public G4UserRunAction
     InputReader* GetInputReader() {return fInputReader;};
     Diagnostics* GetDiagnostics() {return fDiagnostics;};
 
+    RunTallies* GetRunTallies() {return &fRunTallies;};
+
+    void SetShard(G4int shardIndex, G4int numberOfShards) {fShardIndex = shardIndex; fNumberOfShards = numberOfShards;};
+    void SetSummaryFileName(G4String fileName) {fSummaryFileName = (fileName == "none") ? "" : fileName;};
+
+    void SetCommands();
+
   private:
+    void PrintScalingReport(const G4Run* aRun);
+    void SetShardSeeds();
+    G4String GetSummaryFileName() const;
+
     // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
 
     // User pointers
     Units* fUnits; /**< \brief Pointer to the Units instance.*/
+    DetectorConstruction* fDetector; /**< \brief Pointer to the shared DetectorConstruction instance.*/
     InputReader* fInputReader; /**< \brief Pointer to the InputReader instance.*/
     Diagnostics* fDiagnostics; /**< \brief Pointer to the Diagnostics instance.*/
+    WeightWindows* fWeightWindows; /**< \brief Pointer to the shared WeightWindows instance.*/
+    ResponseMatrix* fResponseMatrix; /**< \brief Pointer to the shared ResponseMatrix instance.*/
+    EventScheduler* fEventScheduler; /**< \brief Pointer to the shared EventScheduler instance.*/
+    Checkpoint* fCheckpoint; /**< \brief Pointer to the shared Checkpoint instance.*/
+    AdaptiveStopping* fAdaptiveStopping; /**< \brief Pointer to the shared AdaptiveStopping instance.*/
+    PerformanceReport* fPerformanceReport; /**< \brief Pointer to the shared PerformanceReport instance.*/
+    Telemetry* fTelemetry; /**< \brief Pointer to the shared Telemetry instance.*/
+    TraceRecorder* fTraceRecorder; /**< \brief Pointer to the shared TraceRecorder instance.*/
+    ThreadPlacement* fThreadPlacement; /**< \brief Pointer to the shared ThreadPlacement instance.*/
 
     // User variables
-
+    G4Timer fRunTimer; /**< \brief Wall clock timer of the run, on the master.*/
+    G4int fShardIndex; /**< \brief Index of the shard of this process.*/
+    G4int fNumberOfShards; /**< \brief Number of shards of the run.*/
+    G4String fSummaryFileName; /**< \brief Run summary file, no file if empty.*/
+    RunTallies fRunTallies; /**< \brief Run tallies of this thread, merged on the master.*/
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,98 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file RunTallies.hh
+/// \brief Definition of the RunTallies class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef RunTallies_h
+#define RunTallies_h 1
+
+#include "globals.hh"
+#include "G4VAccumulable.hh"
+
+#include <map>
+#include <utility>
+
+class G4ParticleDefinition;
+
+/**
+\brief Primary and recorded weights of a run, merged with the accumulable manager.
+
+Each RunAction instance registers its own RunTallies. The workers fill them, and
+add them to the master ones at the end of the run with G4AccumulableManager.
+The records are tallied per interface, identified by the layer entered by the
+particle (-1 for the world, when leaving the target), and per species, identified
+by its PDG encoding so that the summary order does not depend on the addresses of
+the particle definitions.
+*/
+class RunTallies : public G4VAccumulable
+{
+  public:
+    RunTallies();
+    virtual ~RunTallies();
+
+    // base class methods
+    virtual void Merge(const G4VAccumulable& other);
+    virtual void Reset();
+
+    // user methods
+    void ScorePrimary(G4double weight);
+    void ScoreRecord(G4int interfaceIndex, const G4ParticleDefinition* particle, G4double weight, G4double energy);
+    void Print(G4int numberOfEvents) const;
+    void Write(const G4String& fileName, G4int numberOfEvents) const;
+
+    // get methods
+    G4long GetNumberOfPrimaries() const {return fNumberOfPrimaries;};
+    G4double GetRecordedWeight(G4int interfaceIndex, const G4String& particleName) const;
+    G4double GetRecordedWeight(const G4ParticleDefinition* particle) const;
+    G4long GetNumberOfRecords() const;
+
+  private:
+    /**
+    \brief Records of one interface and species.
+    */
+    struct Cell
+    {
+      Cell() : particle(nullptr), count(0), weight(0.), energyWeight(0.) {};
+      const G4ParticleDefinition* particle; /**< \brief Particle definition of the species.*/
+      G4long count;          /**< \brief Number of rows recorded.*/
+      G4double weight;       /**< \brief Sum of recorded weights.*/
+      G4double energyWeight; /**< \brief Sum of recorded weights times kinetic energy.*/
+    };
+
+    typedef std::pair<G4int,G4int> CellKey;
+
+    // User variables
+    G4long fNumberOfPrimaries; /**< \brief Number of primaries generated.*/
+    G4double fPrimaryWeight; /**< \brief Sum of the normalized primary weights.*/
+    std::map<CellKey,Cell> fCells; /**< \brief Records per (interface,species).*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -35,6 +35,14 @@
 #include "G4UserSteppingAction.hh"
 
 class Diagnostics;
+class DetectorConstruction;
+class WeightWindows;
+class ResponseMatrix;
+class PerformanceReport;
+class RunTallies;
+class G4StepPoint;
+class G4ParticleDefinition;
+class G4Step;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
 
@@ -46,19 +54,36 @@ This class is instanciated in each worker thread
 class SteppingAction : public G4UserSteppingAction
 {
   public:
-    SteppingAction(Diagnostics* diagnostics);
+    SteppingAction(DetectorConstruction* detector, Diagnostics* diagnostics,
+                   WeightWindows* weightWindows, ResponseMatrix* responseMatrix,
+                   PerformanceReport* performanceReport, RunTallies* runTallies);
    ~SteppingAction();
 
    // base class methods
     virtual void UserSteppingAction(const G4Step*);
 
+    // user methods
+    void ApplyImportanceBiasing(const G4Step* aStep);
+    void ApplyWeightWindow(const G4Step* aStep, G4int layer);
+    void SplitTrack(const G4Step* aStep, G4int numberOfCopies, G4double weight);
+
   private:
+    G4int GetLayerCopyNumber(const G4StepPoint* stepPoint) const;
+    G4bool IsVoxelBoundary(const G4Step* aStep) const;
+    void ScoreRecord(G4int interfaceIndex, const G4ParticleDefinition* particle, const G4StepPoint* stepPoint);
+
     // Geant4 pointers
 
     // User pointers
+    DetectorConstruction* fDetector; /**< \brief Pointer to the shared DetectorConstruction instance.*/
+    WeightWindows* fWeightWindows; /**< \brief Pointer to the shared WeightWindows instance.*/
+    ResponseMatrix* fResponseMatrix; /**< \brief Pointer to the shared ResponseMatrix instance.*/
+    PerformanceReport* fPerformanceReport; /**< \brief Pointer to the shared PerformanceReport instance.*/
     Diagnostics* fDiagnostics; /**< \brief Pointer to the Diagnostics instance of the current thread.*/
+    RunTallies* fRunTallies; /**< \brief Pointer to the RunTallies instance of the current thread.*/
 
     // User variables
+    G4bool fVoxelBoundary; /**< \brief True if the last step ended on a boundary between two voxels of a grid.*/
 };
 
 #endif
@@ -0,0 +1,121 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Telemetry.hh
+/// \brief Definition of the Telemetry class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef Telemetry_h
+#define Telemetry_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+
+#include <map>
+#include <chrono>
+
+class G4GenericMessenger;
+class G4ParticleDefinition;
+class RunTallies;
+
+/**
+\brief Periodically write the progress of the run in a small JSON status file.
+
+This class is shared and instanciated only once. Each worker counts its events
+and the weight recorded by each event, and publishes its counters at most once
+per interval. The thread that publishes after the interval has elapsed rewrites
+the status file, which gives the events done and remaining, the event rates,
+the estimated time left, the output written, the resident memory, and the
+relative error of the recorded weight of each species. The file is replaced
+atomically, so that monitoring scripts never read a partial file.
+*/
+class Telemetry
+{
+  public:
+    Telemetry();
+    ~Telemetry();
+
+    // user methods
+    void BeginOfRun(G4int runID, G4int numberOfEvents, G4int segmentIndex);
+    void ScoreEvent(const RunTallies& tallies);
+    void MergeThreadTallies(const RunTallies& tallies);
+    void EndOfRun();
+
+    // get/set methods
+    void SetFileName(G4String fileName) {fFileName = (fileName == "none") ? "" : fileName;};
+    void SetShard(G4int shardIndex) {fShardSuffix = "_shard" + std::to_string(shardIndex);};
+
+    void SetCommands();
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+    \brief Counters of one thread.
+    */
+    struct Tallies
+    {
+      Tallies() : numberOfEvents(0), numberOfRows(0),
+                  lastWeights{0.,0.,0.}, sums{0.,0.,0.}, sumsOfSquares{0.,0.,0.} {};
+      G4long numberOfEvents;    /**< \brief Number of events started in the run.*/
+      G4long numberOfRows;      /**< \brief Number of phase space rows recorded.*/
+      G4double lastWeights[3];  /**< \brief Recorded weight per species at the start of the current event.*/
+      G4double sums[3];         /**< \brief Sum of the event recorded weights per species.*/
+      G4double sumsOfSquares[3];/**< \brief Sum of the squared event recorded weights per species.*/
+      Clock::time_point start;       /**< \brief Start of the run for this thread.*/
+      Clock::time_point lastPublish; /**< \brief Last time the counters were published.*/
+    };
+
+    void ScoreLastEvent(Tallies& tallies, const RunTallies& runTallies);
+    void Publish(const Tallies& tallies);
+    void WriteStatus(G4bool finished) const;
+    G4long GetResidentMemory() const;
+    G4String GetFileName() const;
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+    const G4ParticleDefinition* fSpecies[3]; /**< \brief Electron, gamma and positron definitions.*/
+
+    // User pointers
+    // User variables
+    G4String fFileName; /**< \brief JSON status file, no file if empty.*/
+    G4String fShardSuffix; /**< \brief Suffix of the status file in shard mode, empty otherwise.*/
+    G4double fInterval; /**< \brief Minimum time between two updates of the status file.*/
+
+    G4int fRunID; /**< \brief ID of the current run.*/
+    G4int fNumberOfEvents; /**< \brief Number of events of the current run.*/
+    G4int fSegmentIndex; /**< \brief Index of the segment of a segmented run, -1 otherwise.*/
+    Clock::time_point fStart; /**< \brief Start of the current run.*/
+    Clock::time_point fLastWrite; /**< \brief Last update of the status file.*/
+
+    G4Cache<Tallies> fThreadTallies; /**< \brief Counters of the current thread.*/
+    std::map<G4int,Tallies> fPublished; /**< \brief Last published counters per thread id.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,84 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ThreadPlacement.hh
+/// \brief Definition of the ThreadPlacement class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ThreadPlacement_h
+#define ThreadPlacement_h 1
+
+#include "globals.hh"
+
+#include <map>
+#include <atomic>
+
+/**
+\brief Report the pinning of the threads and the NUMA placement of their data.
+
+This class is shared and instanciated only once. The workers are pinned to
+cores by Geant4 with /run/pinAffinity, before they build their user actions.
+Each worker then reads its own copy of the input phase space and creates its
+own output buffers, so that their pages are allocated on its NUMA node at the
+first touch. The policy is printed at the first run, and the core and NUMA
+node of each thread at its end.
+*/
+class ThreadPlacement
+{
+  public:
+    ThreadPlacement();
+    ~ThreadPlacement();
+
+    // user methods
+    void BeginOfRun();
+    void RecordThread();
+    void EndOfRun();
+
+  private:
+    G4int GetNumberOfNodes() const;
+    G4int GetNode(G4int cpu) const;
+
+    /**
+    \brief Placement of one thread.
+    */
+    struct Placement
+    {
+      G4int cpu;              /**< \brief Core running the thread, -1 if unknown.*/
+      G4int node;             /**< \brief NUMA node of the core, -1 if unknown.*/
+      G4int numberOfAllowed;  /**< \brief Number of cores allowed by the affinity mask, -1 if unknown.*/
+    };
+
+    // Geant4 pointers
+    // User pointers
+    // User variables
+    std::atomic<G4bool> fReported; /**< \brief True once the placement of the first run is printed, read by the workers.*/
+    std::map<G4int,Placement> fPlacements; /**< \brief Placement per thread id.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,123 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TraceRecorder.hh
+/// \brief Definition of the TraceRecorder class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef TraceRecorder_h
+#define TraceRecorder_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+
+#include <vector>
+#include <map>
+#include <chrono>
+
+class G4GenericMessenger;
+
+/**
+\brief Record timestamped spans per thread and export them as a Chrome trace.
+
+This class is shared and instanciated only once. Each thread appends its spans
+(input load, events, generation, merges, file writes) to its own buffer,
+without lock. The buffers are handed to the shared store once per run, and the
+master writes all the spans of the session in the Chrome trace event format,
+readable with chrome://tracing or Perfetto. When tracing is disabled, each call
+only tests a flag.
+*/
+class TraceRecorder
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    // user methods
+    void BeginOfRun();
+    Clock::time_point Start() const {return fEnabled ? Clock::now() : Clock::time_point();};
+    void AddSpan(const char* name, Clock::time_point start, G4int id = -1);
+    void ScoreEvent(G4int eventID);
+    void MergeThreadTallies();
+    void EndOfRun();
+
+    // get/set methods
+    G4bool IsEnabled() const {return fEnabled;};
+
+    void SetFileName(G4String fileName) {fFileName = (fileName == "none") ? "" : fileName; fEnabled = (fFileName != "");};
+    void SetShard(G4int shardIndex) {fShardSuffix = "_shard" + std::to_string(shardIndex);};
+
+    void SetCommands();
+
+  private:
+    /**
+    \brief Timed section of a thread.
+    */
+    struct Span
+    {
+      const char* name; /**< \brief Span name, a string literal.*/
+      G4int id;         /**< \brief Event ID, or -1.*/
+      G4double start;   /**< \brief Start time from the trace origin (us).*/
+      G4double duration;/**< \brief Duration (us).*/
+    };
+
+    /**
+    \brief Span buffer of one thread.
+    */
+    struct Buffer
+    {
+      Buffer() : eventID(-1), numberOfDropped(0) {};
+      std::vector<Span> spans;       /**< \brief Spans recorded since the last merge.*/
+      G4int eventID;                 /**< \brief ID of the current event, -1 if none.*/
+      Clock::time_point eventStart;  /**< \brief Start of the current event.*/
+      G4long numberOfDropped;        /**< \brief Number of spans dropped since the last merge.*/
+    };
+
+    void WriteTrace() const;
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+
+    // User pointers
+    // User variables
+    G4String fFileName; /**< \brief Chrome trace file, no tracing if empty.*/
+    G4String fShardSuffix; /**< \brief Suffix of the trace file in shard mode, empty otherwise.*/
+    G4bool fEnabled; /**< \brief True if a trace file is set.*/
+    G4int fMaximumSpans; /**< \brief Maximum number of spans kept per thread and run.*/
+
+    G4bool fStarted; /**< \brief True once the trace origin is set.*/
+    Clock::time_point fOrigin; /**< \brief Origin of the trace times, at the first traced run.*/
+    G4Cache<Buffer> fThreadBuffers; /**< \brief Span buffer of the current thread.*/
+    std::map<G4int,std::vector<Span>> fSpans; /**< \brief Merged spans per thread id.*/
+    G4long fNumberOfDropped; /**< \brief Number of spans dropped by all the threads.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
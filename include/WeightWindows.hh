@@ -0,0 +1,124 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file WeightWindows.hh
+/// \brief Definition of the WeightWindows class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef WeightWindows_h
+#define WeightWindows_h 1
+
+#include "globals.hh"
+#include "G4Cache.hh"
+
+#include <vector>
+#include <map>
+
+class G4GenericMessenger;
+
+/**
+\brief Weight windows defined per layer and energy band.
+
+This class is shared and instanciated only once. The window bounds are read-only
+during a run, and the statistics are accumulated per thread then merged at the
+end of the run.
+*/
+class WeightWindows
+{
+  public:
+    WeightWindows();
+    ~WeightWindows();
+
+    // user methods
+    G4int ApplyWeightWindow(G4int layer, G4double energy, G4double& weight);
+    void ScorePilot(G4int layer, G4double energy, G4double weight);
+
+    void BeginOfRun(G4int numberOfEvents);
+    void MergeThreadTallies();
+    void EndOfRun(G4int numberOfEvents);
+
+    // get/set methods
+    G4bool IsActive() const {return fActive;};
+    G4bool IsPilot() const {return fPilotFileName != "";};
+    G4bool HasWeightWindow(G4int layer) const;
+
+    void SetWeightWindow(G4int layer, G4double lowerWeight);
+    void SetNumberOfEnergyBands(G4int numberOfEnergyBands);
+    void SetEnergyMin(G4double energyMin);
+    void SetEnergyMax(G4double energyMax);
+    void SetUpperRatio(G4double upperRatio);
+    void SetSurvivalRatio(G4double survivalRatio);
+    void ReadWeightWindowsFile(G4String fileName);
+    void SetPilotFileName(G4String fileName) {fPilotFileName = (fileName == "none") ? "" : fileName;};
+
+    void SetCommands();
+
+  private:
+    G4int GetEnergyBand(G4double energy) const;
+    G4int GetCellIndex(G4int layer, G4int band) const {return layer * fNumberOfEnergyBands + band;};
+
+    /**
+    \brief Weight windows statistics and pilot tallies of one thread.
+    */
+    struct Tallies
+    {
+      Tallies() : numberOfSplits(0), numberOfCopies(0), numberOfRoulettes(0), numberOfKills(0) {};
+      G4long numberOfSplits;   /**< \brief Number of particles split.*/
+      G4long numberOfCopies;   /**< \brief Number of copies created by splitting.*/
+      G4long numberOfRoulettes;/**< \brief Number of particles played with Russian roulette.*/
+      G4long numberOfKills;    /**< \brief Number of particles killed by Russian roulette.*/
+      std::vector<G4double> pilotWeights; /**< \brief Sum of weights entering each cell.*/
+      std::vector<G4double> pilotCounts;  /**< \brief Number of particles entering each cell.*/
+    };
+
+    // Geant4 pointers
+    G4GenericMessenger* fMessenger; /**< \brief Pointer to the G4GenericMessenger instance.*/
+
+    // User pointers
+    // User variables
+    G4bool fActive; /**< \brief True if at least one weight window is defined for the current run.*/
+    G4int fNumberOfEnergyBands; /**< \brief Number of logarithmic energy bands.*/
+    G4double fEnergyMin; /**< \brief Lower edge of the first energy band.*/
+    G4double fEnergyMax; /**< \brief Upper edge of the last energy band.*/
+    G4double fUpperRatio; /**< \brief Ratio between the upper and lower bounds of a window.*/
+    G4double fSurvivalRatio; /**< \brief Ratio between the survival weight and the lower bound of a window.*/
+    G4int fMaxNumberOfCopies; /**< \brief Maximum number of copies when splitting.*/
+
+    std::vector<G4double> fLowerWeights; /**< \brief Lower bound of each (layer,band) cell for the current run, 0 if no window.*/
+    std::map<G4int,G4double> fManualLowerWeights; /**< \brief Lower bounds given per layer with the UI.*/
+    std::map<G4int,std::vector<G4double>> fFileLowerWeights; /**< \brief Lower bounds per layer and band read from a file.*/
+    G4int fFileNumberOfEvents; /**< \brief Number of events of the pilot run that generated the file.*/
+
+    G4String fPilotFileName; /**< \brief Output file of generated weight windows (pilot mode if not empty).*/
+
+    G4Cache<Tallies> fThreadTallies; /**< \brief Tallies of the current thread.*/
+    Tallies fMergedTallies; /**< \brief Tallies merged over all threads.*/
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -34,19 +34,51 @@
 #include "RunAction.hh"
 #include "SteppingAction.hh"
 #include "Units.hh"
+#include "DetectorConstruction.hh"
 #include "InputReader.hh"
 #include "Diagnostics.hh"
+#include "WeightWindows.hh"
+#include "ResponseMatrix.hh"
+#include "EventScheduler.hh"
+#include "Checkpoint.hh"
+#include "AdaptiveStopping.hh"
+#include "PerformanceReport.hh"
+#include "Telemetry.hh"
+#include "TraceRecorder.hh"
+#include "ThreadPlacement.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 /**
-\brief
+\brief Instanciate the objects shared between master and worker threads.
 
 */
-ActionInitialization::ActionInitialization(Units* units)
+ActionInitialization::ActionInitialization(Units* units, DetectorConstruction* detector)
 : G4VUserActionInitialization(),
-  fUnits(units)
-{}
+  fUnits(units),
+  fDetector(detector),
+  fWeightWindows(nullptr),
+  fResponseMatrix(nullptr),
+  fEventScheduler(nullptr),
+  fCheckpoint(nullptr),
+  fAdaptiveStopping(nullptr),
+  fPerformanceReport(nullptr),
+  fTelemetry(nullptr),
+  fTraceRecorder(nullptr),
+  fThreadPlacement(nullptr),
+  fShardIndex(0),
+  fNumberOfShards(1)
+{
+  fWeightWindows     = new WeightWindows();
+  fResponseMatrix    = new ResponseMatrix(units, detector);
+  fEventScheduler    = new EventScheduler();
+  fAdaptiveStopping  = new AdaptiveStopping();
+  fCheckpoint        = new Checkpoint(fAdaptiveStopping);
+  fPerformanceReport = new PerformanceReport();
+  fTelemetry         = new Telemetry();
+  fTraceRecorder     = new TraceRecorder();
+  fThreadPlacement   = new ThreadPlacement();
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -55,7 +87,37 @@ ActionInitialization::ActionInitialization(Units* units)
 
 */
 ActionInitialization::~ActionInitialization()
-{}
+{
+  delete fWeightWindows;
+  delete fResponseMatrix;
+  delete fEventScheduler;
+  delete fCheckpoint;
+  delete fAdaptiveStopping;
+  delete fPerformanceReport;
+  delete fTelemetry;
+  delete fTraceRecorder;
+  delete fThreadPlacement;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the shard of this process, before the user actions are built.
+
+*/
+void ActionInitialization::SetShard(G4int shardIndex, G4int numberOfShards)
+{
+  fShardIndex = shardIndex;
+  fNumberOfShards = numberOfShards;
+  if (numberOfShards > 1)
+  {
+    fEventScheduler->SetShard(shardIndex, numberOfShards);
+    fCheckpoint->SetShard(shardIndex);
+    fPerformanceReport->SetShard(shardIndex);
+    fTelemetry->SetShard(shardIndex);
+    fTraceRecorder->SetShard(shardIndex);
+  }
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -65,7 +127,9 @@ ActionInitialization::~ActionInitialization()
 */
 void ActionInitialization::BuildForMaster() const
 {
-  // SetUserAction(new RunAction);
+  RunAction* runAction = new RunAction(fUnits, fDetector, nullptr, nullptr, fWeightWindows, fResponseMatrix, fEventScheduler, fCheckpoint, fAdaptiveStopping, fPerformanceReport, fTelemetry, fTraceRecorder, fThreadPlacement);
+  runAction->SetShard(fShardIndex, fNumberOfShards);
+  SetUserAction(runAction);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -78,9 +142,21 @@ void ActionInitialization::Build() const
 {
   InputReader* inputReader = new InputReader(fUnits);
   Diagnostics* diagnostics = new Diagnostics(fUnits);
-  SetUserAction(new RunAction(fUnits, inputReader, diagnostics));
-  SetUserAction(new PrimaryGeneratorAction(inputReader));
-  SetUserAction(new SteppingAction(diagnostics));
+  RunAction* runAction = new RunAction(fUnits, fDetector, inputReader, diagnostics, fWeightWindows, fResponseMatrix, fEventScheduler, fCheckpoint, fAdaptiveStopping, fPerformanceReport, fTelemetry, fTraceRecorder, fThreadPlacement);
+
+  // in shard mode, each process uses a slice of the input and its own outputs and seeds
+  if (fNumberOfShards > 1)
+  {
+    inputReader->SetShard(fShardIndex, fNumberOfShards);
+    diagnostics->SetShard(fShardIndex);
+    runAction->SetShard(fShardIndex, fNumberOfShards);
+  }
+
+  SetUserAction(runAction);
+  SetUserAction(new PrimaryGeneratorAction(inputReader, fResponseMatrix, fEventScheduler, fPerformanceReport,
+                                           fTelemetry, fTraceRecorder, runAction->GetRunTallies()));
+  SetUserAction(new SteppingAction(fDetector, diagnostics, fWeightWindows, fResponseMatrix, fPerformanceReport,
+                                   runAction->GetRunTallies()));
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
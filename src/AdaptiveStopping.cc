@@ -0,0 +1,289 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file AdaptiveStopping.cc
+/// \brief Implementation of the AdaptiveStopping class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "AdaptiveStopping.hh"
+#include "RunTallies.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
+
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+namespace { G4Mutex adaptiveMutex = G4MUTEX_INITIALIZER; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Disable the stopping criteria and call SetCommands.
+
+*/
+AdaptiveStopping::AdaptiveStopping()
+: fMessenger(nullptr),
+  fPrecision(0.),
+  fTimeBudget(0.),
+  fMinimumBatches(10),
+  fRunning(false),
+  fNumberOfBatches(0),
+  fNumberOfPrimaries(0.)
+{
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+AdaptiveStopping::~AdaptiveStopping()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add an observable, the recorded weight of a species entering a layer.
+
+The interface is identified as in the run summary, by the layer entered by the
+particle (-1 for the world), and the particle name `all` selects all species.
+*/
+void AdaptiveStopping::AddObservable(G4int interfaceIndex, G4String particleName)
+{
+  fObservables.push_back(Observable(interfaceIndex, particleName));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the batch sums and start the timer.
+
+This method is called by the master at the beginning of a segmented run.
+*/
+void AdaptiveStopping::Start()
+{
+  for (Observable& observable : fObservables)
+  {
+    observable.sum = 0.;
+    observable.sumOfSquares = 0.;
+  }
+  fNumberOfBatches = 0;
+  fNumberOfPrimaries = 0.;
+  fRunning = true;
+  fTimer.Start();
+
+  if (fPrecision > 0. && fObservables.empty())
+    G4cerr << "No observable selected with /adaptive/addObservable, only the time budget is used" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the tallies of one thread for the current segment as a batch.
+
+This method is called by each worker at the end of each run, before the master
+merges the run tallies.
+*/
+void AdaptiveStopping::AddThreadBatch(const RunTallies& tallies)
+{
+  if (!fRunning) return;
+
+  G4double numberOfPrimaries = tallies.GetNumberOfPrimaries();
+  if (numberOfPrimaries <= 0.) return;
+
+  G4AutoLock lock(&adaptiveMutex);
+  for (Observable& observable : fObservables)
+  {
+    G4double weight = tallies.GetRecordedWeight(observable.interfaceIndex, observable.particleName);
+    observable.sum          += weight;
+    observable.sumOfSquares += weight*weight/numberOfPrimaries;
+  }
+  fNumberOfBatches++;
+  fNumberOfPrimaries += numberOfPrimaries;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the relative error of the total recorded weight of an observable.
+
+The batches have different sizes n_j, so the variance per primary is estimated
+from the batch weights w_j as s^2 = (sum w_j^2/n_j - W^2/N)/(J-1), with W the
+total weight, N the number of primaries and J the number of batches. The
+relative error of W is sqrt(N s^2)/W.
+*/
+G4double AdaptiveStopping::GetRelativeError(G4int observableIndex) const
+{
+  const Observable& observable = fObservables[observableIndex];
+  if (fNumberOfBatches < 2 || observable.sum <= 0.) return DBL_MAX;
+
+  G4double variance = (observable.sumOfSquares - observable.sum*observable.sum/fNumberOfPrimaries)
+                    / (fNumberOfBatches - 1);
+  return std::sqrt(std::max(0., fNumberOfPrimaries*variance)) / observable.sum;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the largest relative error of the observables.
+
+*/
+G4double AdaptiveStopping::GetMaximumRelativeError() const
+{
+  G4double maximumError = 0.;
+  for (size_t i=0; i<fObservables.size(); i++)
+    maximumError = std::max(maximumError, GetRelativeError(i));
+  return maximumError;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if the segmented run must stop after this segment.
+
+The precision is only trusted after the minimum number of batches. The time
+budget is considered spent when the next segment, assumed as long as the mean
+segment, would end after it.
+*/
+G4bool AdaptiveStopping::IsDone(G4int numberOfSegmentsDone)
+{
+  if (!fRunning) return false;
+
+  fTimer.Stop();
+  G4double elapsed = fTimer.GetRealElapsed();
+  G4double maximumError = GetMaximumRelativeError();
+
+  G4cout << "Adaptive segment " << numberOfSegmentsDone << " : "
+         << fNumberOfBatches << " batches ; "
+         << elapsed << " s ; ";
+  if (maximumError < DBL_MAX) G4cout << "max relative error " << maximumError << G4endl;
+  else G4cout << "max relative error not available" << G4endl;
+
+  if (fPrecision > 0. && !fObservables.empty() && fNumberOfBatches >= fMinimumBatches && maximumError <= fPrecision)
+  {
+    G4cout << "Target precision " << fPrecision << " reached" << G4endl;
+    return true;
+  }
+
+  if (fTimeBudget > 0. && numberOfSegmentsDone > 0 && elapsed*(numberOfSegmentsDone + 1)/numberOfSegmentsDone > fTimeBudget/s)
+  {
+    G4cout << "Time budget of " << fTimeBudget/s << " s reached" << G4endl;
+    return true;
+  }
+
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the relative error of each observable at the end of the segmented run.
+
+*/
+void AdaptiveStopping::Finish()
+{
+  if (!fRunning) return;
+  fRunning = false;
+
+  G4cout << G4endl
+         << "--------------------Adaptive stopping-----------------------------" << G4endl
+         << " Batches                    : " << fNumberOfBatches << G4endl
+         << " Primaries                  : " << fNumberOfPrimaries << G4endl
+         << G4endl
+         << " interface species       weight  relative error" << G4endl;
+  for (size_t i=0; i<fObservables.size(); i++)
+  {
+    G4double error = GetRelativeError(i);
+    G4cout << std::setw(10) << fObservables[i].interfaceIndex
+           << std::setw(8)  << fObservables[i].particleName
+           << std::setw(13) << fObservables[i].sum;
+    if (error < DBL_MAX) G4cout << std::setw(16) << error << G4endl;
+    else G4cout << std::setw(16) << "-" << G4endl;
+  }
+  G4cout << "-----------------------------------------------------------------" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/adaptive/setPrecision relativeError
+/adaptive/setTimeBudget time unit
+/adaptive/setMinimumBatches numberOfBatches
+/adaptive/addObservable interfaceIndex particleName
+/adaptive/clearObservables
+*/
+void AdaptiveStopping::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/adaptive/","Stop segmented runs on precision or time budget");
+
+  // define commands
+  G4GenericMessenger::Command& setPrecisionCmd
+    = fMessenger->DeclareProperty("setPrecision",
+                                fPrecision,
+                                "Stop the segmented runs when the relative error of all the observables is below this value (0 for none)");
+
+  G4GenericMessenger::Command& setTimeBudgetCmd
+    = fMessenger->DeclarePropertyWithUnit("setTimeBudget",
+                                "s",
+                                fTimeBudget,
+                                "Stop the segmented runs before the wall time exceeds this budget (0 for none)");
+
+  G4GenericMessenger::Command& setMinimumBatchesCmd
+    = fMessenger->DeclareProperty("setMinimumBatches",
+                                fMinimumBatches,
+                                "Minimum number of (segment,thread) batches before the precision is trusted");
+
+  G4GenericMessenger::Command& addObservableCmd
+    = fMessenger->DeclareMethod("addObservable",
+                                &AdaptiveStopping::AddObservable,
+                                "Add the recorded weight of a species (or all) entering a layer (-1 for the world)");
+
+  G4GenericMessenger::Command& clearObservablesCmd
+    = fMessenger->DeclareMethod("clearObservables",
+                                &AdaptiveStopping::ClearObservables,
+                                "Remove all the observables");
+
+  // set commands properties
+  setPrecisionCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setTimeBudgetCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setMinimumBatchesCmd.SetStates(G4State_PreInit,G4State_Idle);
+  addObservableCmd.SetStates(G4State_PreInit,G4State_Idle);
+  clearObservablesCmd.SetStates(G4State_PreInit,G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
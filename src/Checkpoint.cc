@@ -0,0 +1,239 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Checkpoint.cc
+/// \brief Implementation of the Checkpoint class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "Checkpoint.hh"
+#include "AdaptiveStopping.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Call SetCommands.
+
+*/
+Checkpoint::Checkpoint(AdaptiveStopping* adaptiveStopping)
+: fMessenger(nullptr),
+  fAdaptiveStopping(adaptiveStopping),
+  fFileName("checkpoint"),
+  fShardSuffix(""),
+  fResume(false),
+  fActive(false),
+  fTotalEvents(0),
+  fEventsPerCheckpoint(0),
+  fSegmentIndex(0),
+  fRunEvents(0)
+{
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+Checkpoint::~Checkpoint()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Process the events as successive runs, with a checkpoint after each run.
+
+The segment k writes its outputs in files with the `_seg<k>` suffix. When the
+resume flag is set, the segments already done according to the checkpoint file
+are skipped and the master engine is restored. With adaptive stopping, the run
+stops after the first segment meeting the criteria, and the factor to apply to
+the weights to normalize them by the number of events done is printed.
+*/
+void Checkpoint::BeamOn(G4int numberOfEvents, G4int eventsPerCheckpoint)
+{
+  if (numberOfEvents <= 0 || eventsPerCheckpoint <= 0)
+  {
+    G4cerr << "Invalid segmented run : " << numberOfEvents << " " << eventsPerCheckpoint << G4endl;
+    return;
+  }
+
+  G4int numberOfSegments = (numberOfEvents + eventsPerCheckpoint - 1) / eventsPerCheckpoint;
+  G4int firstSegment = 0;
+  if (fResume)
+  {
+    firstSegment = ReadCheckpoint(numberOfEvents, eventsPerCheckpoint);
+    fResume = false;
+  }
+
+  fTotalEvents = numberOfEvents;
+  fEventsPerCheckpoint = eventsPerCheckpoint;
+  fActive = true;
+
+  G4bool adaptive = fAdaptiveStopping->IsActive();
+  if (adaptive) fAdaptiveStopping->Start();
+
+  G4RunManager* runManager = G4RunManager::GetRunManager();
+  G4int numberOfSegmentsDone = firstSegment;
+  for (fSegmentIndex=firstSegment; fSegmentIndex<numberOfSegments; fSegmentIndex++)
+  {
+    G4int segmentEvents = std::min(eventsPerCheckpoint, numberOfEvents - fSegmentIndex*eventsPerCheckpoint);
+    runManager->BeamOn(segmentEvents);
+    numberOfSegmentsDone = fSegmentIndex + 1;
+    WriteCheckpoint(numberOfSegmentsDone);
+    if (adaptive && numberOfSegmentsDone < numberOfSegments
+        && fAdaptiveStopping->IsDone(numberOfSegmentsDone - firstSegment)) break;
+  }
+
+  if (adaptive)
+  {
+    fAdaptiveStopping->Finish();
+    G4int numberOfEventsDone = GetNumberOfEventsDone(numberOfSegmentsDone);
+    if (numberOfEventsDone < numberOfEvents)
+    {
+      G4cout << "Adaptive stop after " << numberOfEventsDone << " of " << numberOfEvents
+             << " events : the weights of the segments must be multiplied by "
+             << (G4double)numberOfEvents/numberOfEventsDone
+             << " (./merge baseName numberOfShards " << fFileName << ")" << G4endl;
+    }
+  }
+
+  fActive = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Read the checkpoint file and restore the master engine.
+
+Return the number of segments done, or 0 if there is no checkpoint for this
+segmented run.
+*/
+G4int Checkpoint::ReadCheckpoint(G4int numberOfEvents, G4int eventsPerCheckpoint)
+{
+  std::ifstream input(GetFileName());
+  if (!input)
+  {
+    G4cerr << "Checkpoint file " << GetFileName() << " not found, the run starts from the beginning" << G4endl;
+    return 0;
+  }
+
+  G4int totalEvents = 0, segmentEvents = 0, numberOfSegmentsDone = 0;
+  std::string str;
+  while (std::getline(input, str))
+  {
+    if (str.empty() || str[0] == '#') continue;
+    std::stringstream ss(str);
+    ss >> totalEvents >> segmentEvents >> numberOfSegmentsDone;
+    break;
+  }
+  input.close();
+
+  if (totalEvents != numberOfEvents || segmentEvents != eventsPerCheckpoint)
+  {
+    G4cerr << "Checkpoint file " << GetFileName() << " is for another run ("
+           << totalEvents << " events by " << segmentEvents << "), the run starts from the beginning" << G4endl;
+    return 0;
+  }
+
+  G4Random::restoreEngineStatus((GetFileName() + ".rndm").c_str());
+
+  G4cout << "Resume from " << GetFileName() << " : " << numberOfSegmentsDone
+         << " segments of " << segmentEvents << " events done" << G4endl;
+  return numberOfSegmentsDone;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Save the number of segments done and the state of the master engine.
+
+The engine state is written first, so that the checkpoint file never refers to
+a state that is not saved.
+*/
+void Checkpoint::WriteCheckpoint(G4int numberOfSegmentsDone)
+{
+  G4Random::saveEngineStatus((GetFileName() + ".rndm").c_str());
+
+  std::ofstream output(GetFileName());
+  output << "# Checkpoint written by gp3m2" << G4endl;
+  output << "# totalEvents  eventsPerCheckpoint  numberOfSegmentsDone  numberOfEventsDone" << G4endl;
+  output << fTotalEvents << " " << fEventsPerCheckpoint << " " << numberOfSegmentsDone << " "
+         << GetNumberOfEventsDone(numberOfSegmentsDone) << G4endl;
+  output.close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/checkpoint/beamOn numberOfEvents eventsPerCheckpoint
+/checkpoint/setFileName fileName
+/checkpoint/setResume flag
+*/
+void Checkpoint::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/checkpoint/","Manage checkpoints of long runs");
+
+  // define commands
+  G4GenericMessenger::Command& beamOnCmd
+    = fMessenger->DeclareMethod("beamOn",
+                                &Checkpoint::BeamOn,
+                                "Process the events by segments, with a checkpoint after each segment");
+
+  G4GenericMessenger::Command& setFileNameCmd
+    = fMessenger->DeclareProperty("setFileName",
+                                fFileName,
+                                "Set the checkpoint file name");
+
+  G4GenericMessenger::Command& setResumeCmd
+    = fMessenger->DeclareProperty("setResume",
+                                fResume,
+                                "Resume the next segmented run from the checkpoint file");
+
+  // set commands properties
+  beamOnCmd.SetStates(G4State_Idle);
+  beamOnCmd.SetToBeBroadcasted(false);
+  setFileNameCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setResumeCmd.SetStates(G4State_PreInit,G4State_Idle);
+
+  setResumeCmd.SetParameterName("flag",true);
+  setResumeCmd.SetDefaultValue("true");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
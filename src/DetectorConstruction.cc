@@ -31,16 +31,38 @@
 
 #include "Units.hh"
 #include "DetectorConstruction.hh"
+#include "LayerParameterisation.hh"
+#include "FastSimulationModel.hh"
 
 #include "G4NistManager.hh"
+#include "G4Material.hh"
 #include "G4Box.hh"
 #include "G4Tubs.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
+#include "G4PVParameterised.hh"
+#include "G4PhantomParameterisation.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4GeometryManager.hh"
+#include "G4UImanager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 
 #include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+std::set<const G4VPhysicalVolume*> DetectorConstruction::fLayerVolumes;
+std::set<const G4VPhysicalVolume*> DetectorConstruction::fVoxelVolumes;
+
+namespace { G4Mutex fastSimulationMutex = G4MUTEX_INITIALIZER; }
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 /**
@@ -56,7 +78,10 @@ DetectorConstruction::DetectorConstruction(Units* units)
   fPropagationAxis(""),
   fTargetSizeLongi(0),
   fTargetRadius(5*cm),
-  fCheckOverlaps(true)
+  fTargetExtentMax(-DBL_MAX),
+  fLayerRegionName(""),
+  fCheckOverlaps(true),
+  fVoxelDensityStep(0.01)
 {
   // set UI commands
   SetCommands();
@@ -71,6 +96,7 @@ DetectorConstruction::DetectorConstruction(Units* units)
 DetectorConstruction::~DetectorConstruction()
 {
   delete fMessenger;
+  for (auto& it : fLayerRotations) delete it.second;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -122,29 +148,11 @@ void DetectorConstruction::AddTargetLayer(G4String materialName,
                                           G4double targetWidth)
 {
   // Retrieve the new layer material
-  G4NistManager* nist = G4NistManager::Instance();
-  G4Material* layerMat = nist->FindOrBuildMaterial(materialName);
-
-  // Test if the material was properly constructed
-  if (layerMat == nullptr)
-  {
-    G4cerr << "Unknown material : " << materialName << G4endl;
-    throw;
-  }
+  G4Material* layerMat = GetMaterial(materialName);
 
   // Get layer longitudinal size;
   G4double width = targetWidth * fUnits->GetPositionUnitValue();
 
-  // Matrix to rotate the cylinders in the fPropagationAxis direction
-  G4RotationMatrix* rotation = new G4RotationMatrix();
-  if (fPropagationAxis == "x") {
-    rotation->rotateY(90. * deg);
-  } else if (fPropagationAxis == "y") {
-    rotation->rotateX(90. * deg);
-  } else if (fPropagationAxis == "z") {
-    ; // Cylinder is already oriented along the z axis
-  }
-
   // Create layer solid volume
   G4Tubs* layerS =
     new G4Tubs("layerS",                    // name
@@ -161,23 +169,722 @@ void DetectorConstruction::AddTargetLayer(G4String materialName,
                         layerMat,            // material
                         "LayerLV");          // name
 
+  // Attach the layer to its region, for region-specific physics
+  if (fLayerRegionName != "")
+  {
+    G4Region* region = G4RegionStore::GetInstance()->FindOrCreateRegion(fLayerRegionName);
+    region->AddRootLogicalVolume(layerLV);
+  }
+
   // New layer position
   G4ThreeVector position;
   position = G4ThreeVector(fTargetSizeLongi + width/2.,0,0);
 
+  // Check overlaps analytically, as the layers are coaxial
+  if (fCheckOverlaps) CheckLayerOverlaps(width, GetLayerHalfExtent(width, fPropagationAxis), std::max(fTargetRadius, width/2.));
+
   // Create Layer physical volume
-  new G4PVPlacement(rotation,              // rotation
-                    position,              // at (0,0,0)
-                    layerLV,               // logical volume
-                    "Layer",               // name
-                    fWorldLV,              // mother  volume
-                    false,                 // no boolean operation
-                    fNumberOfLayers,       // copy number
-                    fCheckOverlaps);       // overlaps checking
+  G4VPhysicalVolume* layerPV =
+    new G4PVPlacement(GetLayerRotation(fPropagationAxis), // rotation
+                      position,              // at (0,0,0)
+                      layerLV,               // logical volume
+                      "Layer",               // name
+                      fWorldLV,              // mother  volume
+                      false,                 // no boolean operation
+                      fNumberOfLayers,       // copy number
+                      false);                // overlaps checking
+  fLayerVolumes.insert(layerPV);
+
+  // Update target size and number of layers
+  fTargetExtentMax = fTargetSizeLongi + width/2. + GetLayerHalfExtent(width, fPropagationAxis);
+  fTargetSizeLongi += width;
+  fNumberOfLayers++;
+
+  NotifyGeometryModified();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a layer to the period of the next periodic stack.
+
+*/
+void DetectorConstruction::AddPeriodLayer(G4String materialName, G4double layerWidth)
+{
+  fPeriodMaterials.push_back(GetMaterial(materialName));
+  fPeriodWidths.push_back(layerWidth * fUnits->GetPositionUnitValue());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a stack of numberOfPeriods times the current period to the target.
+
+The stack is an envelope cylinder filled by a single physical volume, so that
+the navigation cost does not depend on the number of layers :
+- a G4PVReplica when the period contains only one layer,
+- a G4PVParameterised with a LayerParameterisation otherwise.
+
+The solid and rotation are shared by all the layers of the stack. The layers
+are numbered from the copy number of the envelope, as if they were added one by
+one, and the period is cleared.
+*/
+void DetectorConstruction::AddPeriodicStack(G4int numberOfPeriods)
+{
+  if (fPeriodMaterials.empty() || numberOfPeriods <= 0)
+  {
+    G4cerr << "Invalid periodic stack : " << fPeriodMaterials.size() << " layers per period, "
+           << numberOfPeriods << " periods" << G4endl;
+    return;
+  }
+
+  // The layers are stacked along the propagation axis, +x by default
+  G4String stackAxis = (fPropagationAxis == "") ? "x" : fPropagationAxis;
+
+  // Check that the layers are numbered along the beam, copy 0 being at the local -z end
+  G4ThreeVector propagationAxis((stackAxis == "x") ? 1. : 0., (stackAxis == "y") ? 1. : 0., (stackAxis == "z") ? 1. : 0.);
+  if ((GetLayerRotation(stackAxis)->inverse() * G4ThreeVector(0., 0., 1.)).dot(propagationAxis) < 0.5)
+  {
+    G4cerr << "Invalid periodic stack : the first layer is not the first one hit by the beam along "
+           << stackAxis << G4endl;
+    return;
+  }
+
+  LayerParameterisation* parameterisation
+    = new LayerParameterisation(fPeriodMaterials, fPeriodWidths, numberOfPeriods);
+  G4int numberOfLayers = parameterisation->GetNumberOfLayers();
+  G4double width = parameterisation->GetTotalWidth();
+
+  // Create the stack envelope
+  G4Tubs* stackS =
+    new G4Tubs("layerStackS",                 // name
+               0.,                            // inner radius
+               fTargetRadius,                 // outer radius
+               width/2.,                      // z-half length
+               0.,                            // starting Phi
+               twopi);                        // segment angle
+
+  G4LogicalVolume* stackLV =
+    new G4LogicalVolume(stackS,               // solid
+                        fPeriodMaterials[0],  // material
+                        "LayerStackLV");      // name
+
+  // Attach the stack to its region, for region-specific physics
+  if (fLayerRegionName != "")
+  {
+    G4Region* region = G4RegionStore::GetInstance()->FindOrCreateRegion(fLayerRegionName);
+    region->AddRootLogicalVolume(stackLV);
+  }
+
+  // Create the layer solid and logical volume shared by all the layers
+  G4Tubs* layerS =
+    new G4Tubs("layerS",                              // name
+               0.,                                    // inner radius
+               fTargetRadius,                         // outer radius
+               parameterisation->GetMaximumWidth()/2.,// z-half length
+               0.,                                    // starting Phi
+               twopi);                                // segment angle
+
+  G4LogicalVolume* layerLV =
+    new G4LogicalVolume(layerS,               // solid
+                        fPeriodMaterials[0],  // material
+                        "LayerLV");           // name
+
+  // Fill the envelope with the layers
+  G4VPhysicalVolume* layerPV = nullptr;
+  if (fPeriodMaterials.size() == 1)
+  {
+    layerPV =
+      new G4PVReplica("Layer",                  // name
+                      layerLV,                  // logical volume
+                      stackLV,                  // mother volume
+                      kZAxis,                   // replication axis
+                      numberOfLayers,           // number of replicas
+                      fPeriodWidths[0]);        // width of a replica
+    delete parameterisation;
+  }
+  else
+  {
+    layerPV =
+      new G4PVParameterised("Layer",            // name
+                            layerLV,            // logical volume
+                            stackLV,            // mother volume
+                            kZAxis,             // axis of the voxels optimisation
+                            numberOfLayers,     // number of layers
+                            parameterisation,   // parameterisation
+                            false);             // overlaps checking
+  }
+  fLayerVolumes.insert(layerPV);
+
+  // Check overlaps analytically, the layers of the stack being contiguous by construction
+  if (fCheckOverlaps) CheckLayerOverlaps(width, GetLayerHalfExtent(width, stackAxis), std::max(fTargetRadius, width/2.));
+
+  // Place the stack after the previous layers
+  new G4PVPlacement(GetLayerRotation(stackAxis),                     // rotation
+                    G4ThreeVector(fTargetSizeLongi + width/2.,0,0),  // position
+                    stackLV,                                         // logical volume
+                    "LayerStack",                                    // name
+                    fWorldLV,                                        // mother  volume
+                    false,                                           // no boolean operation
+                    fNumberOfLayers,                                 // copy number of the first layer
+                    false);                                          // overlaps checking
+
+  // Update target size and number of layers
+  fTargetExtentMax = fTargetSizeLongi + width/2. + GetLayerHalfExtent(width, stackAxis);
+  fTargetSizeLongi += width;
+  fNumberOfLayers += numberOfLayers;
+
+  fPeriodMaterials.clear();
+  fPeriodWidths.clear();
+
+  NotifyGeometryModified();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a voxelized target read from a 3D grid file.
+
+The file format is :
+nx  ny  nz  dx  dy  dz
+numberOfMaterials  materialName0  materialName1  ...
+materialIndex  density(g/cm3)
+materialIndex  density(g/cm3)
+...
+
+with the voxel sizes in position unit, one line per voxel with the x index
+running fastest, then y and z, and lines starting with # being ignored.
+Voxels with a negative material index or a null density are empty.
+
+The densities are rounded with a relative step fVoxelDensityStep, and a material
+is built for each (material, density) pair. The voxels are placed in a box
+container with a G4PhantomParameterisation, and navigated with the regular
+navigation, which skips the boundaries between voxels of the same material.
+
+The x axis of the grid is the propagation axis, and the grid is placed after the
+previous layers. The grid is numbered as a single layer.
+*/
+void DetectorConstruction::AddVoxelGrid(G4String fileName)
+{
+  std::ifstream input(fileName);
+  if (!input)
+  {
+    G4cerr << "Voxel grid file " << fileName << " not found ..." << G4endl;
+    return;
+  }
+
+  // Read the grid dimensions and materials
+  G4int nx = 0, ny = 0, nz = 0;
+  G4double dx = 0., dy = 0., dz = 0.;
+  std::vector<G4String> materialNames;
+  std::string str;
+  while (std::getline(input, str))
+  {
+    if (str.empty() || str[0] == '#') continue;
+    std::stringstream ss(str);
+
+    if (nx == 0)
+    {
+      ss >> nx >> ny >> nz >> dx >> dy >> dz;
+    }
+    else
+    {
+      G4int numberOfMaterials = 0;
+      ss >> numberOfMaterials;
+      materialNames.resize(numberOfMaterials);
+      for (G4String& materialName : materialNames) ss >> materialName;
+      break;
+    }
+  }
+
+  if (nx <= 0 || ny <= 0 || nz <= 0 || dx <= 0. || dy <= 0. || dz <= 0. || materialNames.empty())
+  {
+    G4cerr << "Invalid voxel grid header in " << fileName << G4endl;
+    return;
+  }
+
+  // Read the voxels, and build a material for each (material, density) pair
+  G4int numberOfVoxels = nx * ny * nz;
+  G4Material* vacuum = GetMaterial("G4_Galactic");
+  G4double logDensityStep = std::log(1. + fVoxelDensityStep);
+
+  std::vector<G4Material*> materials;
+  std::map<std::pair<G4int,G4int>,size_t> materialIds;
+  std::vector<size_t> indices(numberOfVoxels, 0);
+
+  G4int voxel = 0;
+  while (voxel < numberOfVoxels && std::getline(input, str))
+  {
+    if (str.empty() || str[0] == '#') continue;
+    std::stringstream ss(str);
+
+    G4int materialIndex = -1;
+    G4double density = 0.;
+    ss >> materialIndex >> density;
+
+    std::pair<G4int,G4int> key(-1, 0);
+    if (materialIndex >= 0 && materialIndex < (G4int)materialNames.size() && density > 0.)
+    {
+      key = std::make_pair(materialIndex, (G4int)std::lround(std::log(density) / logDensityStep));
+    }
+
+    auto it = materialIds.find(key);
+    if (it == materialIds.end())
+    {
+      G4Material* material = vacuum;
+      if (key.first >= 0)
+      {
+        G4double roundedDensity = std::exp(key.second * logDensityStep) * g/cm3;
+        std::ostringstream materialName;
+        materialName << materialNames[key.first] << "_" << roundedDensity/(g/cm3);
+
+        material = G4Material::GetMaterial(materialName.str(), false);
+        if (material == nullptr)
+        {
+          GetMaterial(materialNames[key.first]);
+          material = G4NistManager::Instance()->BuildMaterialWithNewDensity(materialName.str(),
+                                                                            materialNames[key.first],
+                                                                            roundedDensity);
+        }
+      }
+      it = materialIds.insert(std::make_pair(key, materials.size())).first;
+      materials.push_back(material);
+    }
+    indices[voxel++] = it->second;
+  }
+  input.close();
+
+  if (voxel < numberOfVoxels)
+  {
+    G4cerr << "Voxel grid file " << fileName << " contains " << voxel
+           << " voxels instead of " << numberOfVoxels << G4endl;
+    return;
+  }
+
+  // Get voxel and grid sizes
+  G4double rUnit = fUnits->GetPositionUnitValue();
+  G4double voxelHalfX = dx * rUnit / 2., voxelHalfY = dy * rUnit / 2., voxelHalfZ = dz * rUnit / 2.;
+  G4double width = nx * dx * rUnit;
+
+  // Create the grid container
+  G4Box* gridS =
+    new G4Box("voxelGridS",                   // name
+              nx * voxelHalfX,                // half size X
+              ny * voxelHalfY,                // half size Y
+              nz * voxelHalfZ);               // half size Z
+
+  G4LogicalVolume* gridLV =
+    new G4LogicalVolume(gridS,                // solid
+                        vacuum,               // material
+                        "VoxelGridLV_" + fileName); // name
+
+  // Attach the grid to its region, for region-specific physics
+  if (fLayerRegionName != "")
+  {
+    G4Region* region = G4RegionStore::GetInstance()->FindOrCreateRegion(fLayerRegionName);
+    region->AddRootLogicalVolume(gridLV);
+  }
+
+  // Create the voxel solid and logical volume shared by all the voxels
+  G4Box* voxelS = new G4Box("voxelS", voxelHalfX, voxelHalfY, voxelHalfZ);
+  G4LogicalVolume* voxelLV = new G4LogicalVolume(voxelS, materials[0], "VoxelLV");
+
+  // Define the voxels parameterisation
+  fVoxelMaterialIndices.push_back(std::move(indices));
+  G4PhantomParameterisation* parameterisation = new G4PhantomParameterisation();
+  parameterisation->SetVoxelDimensions(voxelHalfX, voxelHalfY, voxelHalfZ);
+  parameterisation->SetNoVoxel(nx, ny, nz);
+  parameterisation->SetMaterials(materials);
+  parameterisation->SetMaterialIndices(fVoxelMaterialIndices.back().data());
+  parameterisation->SetSkipEqualMaterials(true);
+
+  // Check overlaps analytically
+  if (fCheckOverlaps) CheckLayerOverlaps(width, width/2., std::max(ny * voxelHalfY, nz * voxelHalfZ));
+
+  // Place the grid after the previous layers
+  G4VPhysicalVolume* gridPV =
+    new G4PVPlacement(nullptr,                                         // no rotation
+                      G4ThreeVector(fTargetSizeLongi + width/2.,0,0),  // position
+                      gridLV,                                          // logical volume
+                      "VoxelGrid",                                     // name
+                      fWorldLV,                                        // mother  volume
+                      false,                                           // no boolean operation
+                      fNumberOfLayers,                                 // copy number
+                      false);                                          // overlaps checking
+
+  parameterisation->BuildContainerSolid(gridPV);
+  parameterisation->CheckVoxelsFillContainer(gridS->GetXHalfLength(),
+                                             gridS->GetYHalfLength(),
+                                             gridS->GetZHalfLength());
+
+  // Fill the container with the voxels, using the regular navigation
+  G4PVParameterised* voxelPV =
+    new G4PVParameterised("Voxel",            // name
+                          voxelLV,            // logical volume
+                          gridLV,             // mother volume
+                          kUndefined,         // no voxels optimisation, the structure being regular
+                          numberOfVoxels,     // number of voxels
+                          parameterisation,   // parameterisation
+                          false);             // overlaps checking
+  voxelPV->SetRegularStructureId(1);
+  fVoxelVolumes.insert(voxelPV);
+
+  G4cout << "Voxel grid " << fileName << " : " << numberOfVoxels << " voxels, "
+         << materials.size() << " materials" << G4endl;
 
   // Update target size and number of layers
+  fTargetExtentMax = fTargetSizeLongi + width;
   fTargetSizeLongi += width;
   fNumberOfLayers++;
+
+  NotifyGeometryModified();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Remove all the target layers, to build a new target in the same session.
+
+The layers and stacks volumes and solids are deleted, and the target size, number
+of layers and layer importances are reset. The materials, regions and physics
+tables are kept, so that the tables of already used materials are not rebuilt.
+*/
+void DetectorConstruction::ClearTarget()
+{
+  // Open the geometry before modifying it
+  G4GeometryManager::GetInstance()->OpenGeometry();
+
+  while (fWorldLV->GetNoDaughters() > 0)
+  {
+    G4VPhysicalVolume* layerPV = fWorldLV->GetDaughter(0);
+    G4LogicalVolume* layerLV = layerPV->GetLogicalVolume();
+    G4VSolid* layerS = layerLV->GetSolid();
+
+    // Detach the layer from the world and from its region
+    fWorldLV->RemoveDaughter(layerPV);
+    G4Region* region = layerLV->GetRegion();
+    if (region && region->GetName() != "DefaultRegionForTheWorld")
+    {
+      region->RemoveRootLogicalVolume(layerLV);
+    }
+
+    // Delete the layers of a periodic stack
+    while (layerLV->GetNoDaughters() > 0)
+    {
+      G4VPhysicalVolume* daughterPV = layerLV->GetDaughter(0);
+      G4LogicalVolume* daughterLV = daughterPV->GetLogicalVolume();
+      G4VSolid* daughterS = daughterLV->GetSolid();
+      G4VPVParameterisation* parameterisation = daughterPV->GetParameterisation();
+
+      layerLV->RemoveDaughter(daughterPV);
+      delete daughterPV;
+      delete daughterLV;
+      delete daughterS;
+      delete parameterisation;
+    }
+
+    delete layerPV;
+    delete layerLV;
+    delete layerS;
+  }
+
+  fVoxelMaterialIndices.clear();
+  fLayerVolumes.clear();
+  fVoxelVolumes.clear();
+
+  // Reset target properties
+  fTargetExtentMax = -DBL_MAX;
+  fTargetSizeLongi = 0.;
+  fNumberOfLayers = 0;
+  fLayerImportances.clear();
+
+  NotifyGeometryModified();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if the volume is a layer or a voxel of the target.
+
+The volumes are recorded when built, so that no name is compared at each step.
+*/
+G4bool DetectorConstruction::IsTargetVolume(const G4VPhysicalVolume* volume)
+{
+  return fLayerVolumes.count(volume) > 0 || fVoxelVolumes.count(volume) > 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if the volume is a voxel of a voxel grid.
+
+*/
+G4bool DetectorConstruction::IsVoxelVolume(const G4VPhysicalVolume* volume)
+{
+  return fVoxelVolumes.count(volume) > 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the material of given name, from the NIST database.
+
+*/
+G4Material* DetectorConstruction::GetMaterial(G4String materialName) const
+{
+  G4NistManager* nist = G4NistManager::Instance();
+  G4Material* material = nist->FindOrBuildMaterial(materialName);
+
+  // Test if the material was properly constructed
+  if (material == nullptr)
+  {
+    G4cerr << "Unknown material : " << materialName << G4endl;
+    throw;
+  }
+
+  return material;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the matrix rotating the cylinders in the given axis direction.
+
+The matrix is created once per axis and shared by all the layers. As the
+placement rotation is applied to the mother frame, the local +z axis of the
+layers is mapped on the positive propagation axis, so that the first layer of a
+periodic stack is the first one hit by the beam.
+*/
+G4RotationMatrix* DetectorConstruction::GetLayerRotation(const G4String& axis)
+{
+  G4RotationMatrix*& rotation = fLayerRotations[axis];
+  if (rotation == nullptr)
+  {
+    rotation = new G4RotationMatrix();
+    if (axis == "x") {
+      rotation->rotateY(-90. * deg);
+    } else if (axis == "y") {
+      rotation->rotateX(90. * deg);
+    } else if (axis == "z") {
+      ; // Cylinder is already oriented along the z axis
+    }
+  }
+  return rotation;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the half extent along x of a layer of given width.
+
+*/
+G4double DetectorConstruction::GetLayerHalfExtent(G4double width, const G4String& axis) const
+{
+  return (axis == "x") ? width/2. : fTargetRadius;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Check if a new layer of given width overlaps the target or the world boundaries.
+
+As the layers are coaxial volumes stacked along x, the check is done on their
+half extents along x and in the transverse directions, and does not need to
+sample points on the surface of the new layer.
+Overlaps are reported, and true is returned if an overlap is detected.
+*/
+G4bool DetectorConstruction::CheckLayerOverlaps(G4double width, G4double halfExtent, G4double transverseHalfExtent) const
+{
+  G4double center        = fTargetSizeLongi + width/2.;
+  G4double worldHalfSize = static_cast<const G4Box*>(fWorldLV->GetSolid())->GetXHalfLength();
+
+  if (center - halfExtent < fTargetExtentMax - kCarTolerance)
+  {
+    G4cerr << "Overlap detected : layer " << fNumberOfLayers
+           << " overlaps the previous layers along x, check the propagation axis" << G4endl;
+    return true;
+  }
+
+  if (center + halfExtent > worldHalfSize || transverseHalfExtent > worldHalfSize)
+  {
+    G4cerr << "Overlap detected : layer " << fNumberOfLayers << " extends outside the world" << G4endl;
+    return true;
+  }
+
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Tell the master and worker run managers that the geometry must be closed again.
+
+The command is used instead of a direct call, so that it is also broadcasted to
+the worker threads at the next run.
+*/
+void DetectorConstruction::NotifyGeometryModified()
+{
+  G4UImanager::GetUIpointer()->ApplyCommand("/run/geometryModified");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a region whose layers are handled by a fast simulation model.
+
+The model is attached by each thread at the beginning of the next run.
+*/
+void DetectorConstruction::AddFastSimulationRegion(G4String regionName)
+{
+  if (std::find(fFastSimulationRegions.begin(), fFastSimulationRegions.end(), regionName) == fFastSimulationRegions.end())
+  {
+    fFastSimulationRegions.push_back(regionName);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Attach a fast simulation model to the requested regions not yet handled by this thread.
+
+The fast simulation managers of the regions are thread-local, so that this
+method is called by each thread processing events at the beginning of each run,
+and the regions given in Idle state are taken into account at the next run.
+*/
+void DetectorConstruction::AttachFastSimulationModels()
+{
+  std::map<G4String,FastSimulationModel*>& models = fFastSimulationModels.Get();
+
+  for (const G4String& regionName : fFastSimulationRegions)
+  {
+    if (models.count(regionName)) continue;
+
+    G4Region* region = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+    if (!region || region == G4RegionStore::GetInstance()->GetRegion("DefaultRegionForTheWorld", false))
+    {
+      G4cerr << "Invalid fast simulation region : " << regionName << G4endl;
+      continue;
+    }
+
+    // The model is attached to the region and owned by its G4FastSimulationManager
+    models[regionName] = new FastSimulationModel("FastSimulationModel_" + regionName, region);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the number of particles handled by the models of this thread to the merged counts.
+
+This method is called by each thread processing events at the end of each run.
+*/
+void DetectorConstruction::MergeFastSimulationCounts()
+{
+  G4AutoLock lock(&fastSimulationMutex);
+  for (auto& it : fFastSimulationModels.Get())
+  {
+    fFastSimulationCounts[it.first] += it.second->GetNumberOfCalls();
+    it.second->ResetNumberOfCalls();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the number of particles handled by the fast simulation model of each region.
+
+A region whose model never triggered is reported, as its layers are then fully
+simulated. This method is called by the master at the end of each run.
+*/
+void DetectorConstruction::PrintFastSimulationCounts()
+{
+  for (const G4String& regionName : fFastSimulationRegions)
+  {
+    G4long numberOfCalls = fFastSimulationCounts[regionName];
+    G4cout << "Fast simulation in region " << regionName << " : " << numberOfCalls << " particles handled" << G4endl;
+    if (numberOfCalls == 0)
+    {
+      G4cerr << "Fast simulation model of region " << regionName << " never triggered, check its layers" << G4endl;
+    }
+  }
+  fFastSimulationCounts.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return a description of the current target, used to identify cached results.
+
+The description contains the material, position and dimensions of each layer,
+as well as the regions and fast simulation settings.
+*/
+G4String DetectorConstruction::GetConfiguration() const
+{
+  std::ostringstream configuration;
+  configuration.precision(12);
+  configuration << "axis " << fPropagationAxis;
+
+  for (G4int i=0; i<(G4int)fWorldLV->GetNoDaughters(); i++)
+  {
+    const G4VPhysicalVolume* layerPV = fWorldLV->GetDaughter(i);
+    const G4LogicalVolume* layerLV = layerPV->GetLogicalVolume();
+    const G4Tubs* layerS = dynamic_cast<const G4Tubs*>(layerLV->GetSolid());
+
+    configuration << " ; " << layerPV->GetName() << " " << layerPV->GetCopyNo()
+                  << " " << layerLV->GetName()
+                  << " " << layerLV->GetMaterial()->GetName()
+                  << " " << layerPV->GetTranslation().x()/um;
+    if (layerS)
+    {
+      configuration << " " << layerS->GetOuterRadius()/um << " " << 2.*layerS->GetZHalfLength()/um;
+    }
+    if (layerLV->GetRegion())
+    {
+      configuration << " " << layerLV->GetRegion()->GetName();
+    }
+
+    // Layers of a periodic stack
+    for (G4int j=0; j<(G4int)layerLV->GetNoDaughters(); j++)
+    {
+      const G4VPhysicalVolume* daughterPV = layerLV->GetDaughter(j);
+      const LayerParameterisation* parameterisation
+        = dynamic_cast<const LayerParameterisation*>(daughterPV->GetParameterisation());
+      configuration << " " << daughterPV->GetMultiplicity()
+                    << " " << daughterPV->GetLogicalVolume()->GetMaterial()->GetName();
+      if (parameterisation) configuration << " " << parameterisation->GetConfiguration();
+    }
+  }
+
+  for (const G4String& regionName : fFastSimulationRegions)
+  {
+    configuration << " ; fast " << regionName;
+  }
+
+  return configuration.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the importance of the layer with given copy number.
+
+Particles crossing an interface between two layers are split or played with
+Russian roulette according to the importance ratio of these layers.
+Layers without given importance have an importance of 1.
+*/
+void DetectorConstruction::SetLayerImportance(G4int copyNumber, G4double importance)
+{
+  if (copyNumber < 0 || importance <= 0.)
+  {
+    G4cerr << "Invalid layer importance : " << copyNumber << " " << importance << G4endl;
+    return;
+  }
+
+  if (copyNumber >= (G4int)fLayerImportances.size())
+  {
+    fLayerImportances.resize(copyNumber+1, 1.);
+  }
+  fLayerImportances[copyNumber] = importance;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -188,6 +895,35 @@ void DetectorConstruction::AddTargetLayer(G4String materialName,
 The AddTargetLayer function can be called in UI in the following way :
 
 /target/addLayer materialName width
+
+Layers added after
+
+/target/setLayerRegion regionName
+
+belong to the given region (`none` goes back to the world region).
+
+A periodic stack of many thin layers is added with
+
+/target/addPeriodLayer materialName width
+/target/addPeriodLayer materialName width
+/target/addPeriodicStack numberOfPeriods
+
+A voxelized target is read from a 3D grid file with
+
+/target/setVoxelDensityStep relativeStep
+/target/addVoxelGrid fileName
+
+All the layers are removed, to build a new target, with
+
+/target/clear
+
+The importance of a layer is set with
+
+/target/setImportance copyNumber importance
+
+The layers of a region are handled by a fast simulation model after
+
+/target/setFastSimulation regionName
 */
 void DetectorConstruction::SetCommands()
 {
@@ -199,6 +935,26 @@ void DetectorConstruction::SetCommands()
     = fMessenger->DeclareMethod("addLayer",
                                 &DetectorConstruction::AddTargetLayer,
                                 "Add a new layer to the target");
+  G4GenericMessenger::Command& addPeriodLayerCmd
+    = fMessenger->DeclareMethod("addPeriodLayer",
+                                &DetectorConstruction::AddPeriodLayer,
+                                "Add a layer to the period of the next periodic stack");
+  G4GenericMessenger::Command& addPeriodicStackCmd
+    = fMessenger->DeclareMethod("addPeriodicStack",
+                                &DetectorConstruction::AddPeriodicStack,
+                                "Add a stack of the given number of periods to the target");
+  G4GenericMessenger::Command& addVoxelGridCmd
+    = fMessenger->DeclareMethod("addVoxelGrid",
+                                &DetectorConstruction::AddVoxelGrid,
+                                "Add a voxelized target read from a 3D grid file");
+  G4GenericMessenger::Command& setVoxelDensityStepCmd
+    = fMessenger->DeclareProperty("setVoxelDensityStep",
+                                fVoxelDensityStep,
+                                "Set the relative density step used to define the voxel materials");
+  G4GenericMessenger::Command& clearTargetCmd
+    = fMessenger->DeclareMethod("clear",
+                                &DetectorConstruction::ClearTarget,
+                                "Remove all the target layers");
   G4GenericMessenger::Command& setTargetRadiusCmd
     = fMessenger->DeclareMethod("setRadius",
                                 &DetectorConstruction::SetTargetRadius,
@@ -207,10 +963,30 @@ void DetectorConstruction::SetCommands()
     = fMessenger->DeclareMethod("setPropagationAxis",
                                 &DetectorConstruction::SetPropagationAxis,
                                 "Make the targer layers being oriented along the propagation axis");
+  G4GenericMessenger::Command& setLayerRegionCmd
+    = fMessenger->DeclareMethod("setLayerRegion",
+                                &DetectorConstruction::SetLayerRegion,
+                                "Set the region of the next layers (none for the world region)");
+  G4GenericMessenger::Command& setLayerImportanceCmd
+    = fMessenger->DeclareMethod("setImportance",
+                                &DetectorConstruction::SetLayerImportance,
+                                "Set the importance of the layer with given copy number");
+  G4GenericMessenger::Command& addFastSimulationRegionCmd
+    = fMessenger->DeclareMethod("setFastSimulation",
+                                &DetectorConstruction::AddFastSimulationRegion,
+                                "Use a fast simulation model in the layers of the given region");
   // set commands properties
   setTargetRadiusCmd.SetStates(G4State_Idle);
   setPropagationAxisCmd.SetStates(G4State_Idle);
   addLayerCmd.SetStates(G4State_Idle);
+  addPeriodLayerCmd.SetStates(G4State_Idle);
+  addPeriodicStackCmd.SetStates(G4State_Idle);
+  addVoxelGridCmd.SetStates(G4State_Idle);
+  setVoxelDensityStepCmd.SetStates(G4State_Idle);
+  clearTargetCmd.SetStates(G4State_Idle);
+  setLayerRegionCmd.SetStates(G4State_Idle);
+  setLayerImportanceCmd.SetStates(G4State_Idle);
+  addFastSimulationRegionCmd.SetStates(G4State_Idle);
 
 }
 
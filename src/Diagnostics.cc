@@ -54,8 +54,11 @@ Diagnostics::Diagnostics(Units* units)
   fPositron(nullptr),
   fUnits(units),
   fOutputFileBaseName("results"),
+  fShardSuffix(""),
+  fSegmentSuffix(""),
   fLowEnergyLimit(0.),
-  fDiagSurfacePhaseSpaceActivation(false)
+  fDiagSurfacePhaseSpaceActivation(false),
+  fNtuplesCreated(false)
 {
   fParticleTable = G4ParticleTable::GetParticleTable();
 
@@ -87,18 +90,23 @@ Diagnostics::~Diagnostics()
 /**
 \brief Initialize diagnostics by opening output files.
 
+The Ntuples are only created at the first run, and reused by the next ones.
+In shard mode and during a segmented run, the shard and segment indices are
+appended to the file base name.
 */
 void Diagnostics::InitializeAllDiags()
 {
   // open output file
-  fAnalysisManager->OpenFile(fOutputFileBaseName);
+  fAnalysisManager->OpenFile(fOutputFileBaseName + fShardSuffix + fSegmentSuffix);
+
+  if (fNtuplesCreated) return;
 
   fAnalysisManager->SetFirstNtupleId(0);
   fAnalysisManager->SetFirstNtupleColumnId(0);
   // fAnalysisManager->SetNtupleMerging(true);
 
   CreateDiagSurfacePhaseSpace();
-
+  fNtuplesCreated = true;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -137,8 +145,9 @@ void Diagnostics::CreateDiagSurfacePhaseSpace()
 /**
 \brief Fill the particle phase space diagnostic at each layer surface.
 
+Return true if a row is recorded.
 */
-void Diagnostics::FillDiagSurfacePhaseSpace(const G4ParticleDefinition* part, const G4StepPoint* stepPoint)
+G4bool Diagnostics::FillDiagSurfacePhaseSpace(const G4ParticleDefinition* part, const G4StepPoint* stepPoint)
 {
   // Test for filling the diag
   if (stepPoint->GetStepStatus() == fGeomBoundary &&            // The step is limited by the geometry
@@ -175,8 +184,10 @@ void Diagnostics::FillDiagSurfacePhaseSpace(const G4ParticleDefinition* part, co
       fAnalysisManager->FillNtupleDColumn(NtupleID,7,t/tUnit);
 
       fAnalysisManager->AddNtupleRow(NtupleID);
+      return true;
     }
   }
+  return false;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,446 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file EventScheduler.cc
+/// \brief Implementation of the EventScheduler class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "EventScheduler.hh"
+#include "InputReader.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+  G4Mutex schedulerMutex = G4MUTEX_INITIALIZER;
+
+  /** \brief Mix a 64 bits integer (splitmix64 finalizer).*/
+  uint64_t Mix(uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set default scheduling parameters and call SetCommands.
+
+*/
+EventScheduler::EventScheduler()
+: fMessenger(nullptr),
+  fCostOrdering(false),
+  fNumberOfEnergyBins(20),
+  fReorderInterval(1000),
+  fEventSeed(0),
+  fShardIndex(0),
+  fNumberOfShards(1),
+  fRunKey(0),
+  fFirstEventIndex(0),
+  fPrepared(false),
+  fCursor(0),
+  fNumberOfDispatched(0),
+  fNextReorder(0),
+  fTotalTime(0.),
+  fTotalEnergy(0.)
+{
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+EventScheduler::~EventScheduler()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the order and the thread reports, and set the event indices of the run.
+
+This method is called by the master at the beginning of each run, with the run
+ID as run key. During a segmented run, the run key is 0 and the first event
+index is the one of the segment, so that the segments use the same event seeds
+as a single run.
+*/
+void EventScheduler::BeginOfRun(G4int runKey, G4int firstEventIndex)
+{
+  fPrepared = false;
+  fThreadReports.clear();
+  fRunKey = runKey;
+  fFirstEventIndex = firstEventIndex;
+
+  if (fEventSeed != 0 && fCostOrdering)
+    G4cerr << "Cost ordering depends on the event times, the events are not reproducible with an event seed" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reseed the engine of the thread for an event.
+
+The seeds are hashed from the event seed, the shard, the run and the global
+event index. The event, including the choice of its macro-particles, thus only
+depends on its index, whatever the thread processing it. This method is called
+at the beginning of each event, before the primaries are generated.
+*/
+void EventScheduler::SeedEvent(G4int eventID) const
+{
+  if (fEventSeed == 0) return;
+
+  uint64_t hash = Mix((uint64_t)fEventSeed);
+  hash = Mix(hash ^ (uint64_t)fShardIndex);
+  hash = Mix(hash ^ (uint64_t)fNumberOfShards);
+  hash = Mix(hash ^ (uint64_t)fRunKey);
+  hash = Mix(hash ^ (uint64_t)(fFirstEventIndex + eventID));
+
+  long seeds[3] = {(long)(hash & 0x7fffffff), (long)((hash >> 32) & 0x7fffffff), 0};
+  if (seeds[0] == 0) seeds[0] = 1;
+  if (seeds[1] == 0) seeds[1] = 1;
+  G4Random::setTheSeeds(seeds);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Build the order of the macro-particles for the run.
+
+Each macro-particle is used N/M times, N being the number of primaries and M the
+number of macro-particles, and the remainder is picked at random without
+replacement. The expected number of uses is thus the same as with random
+picking, and the weight normalization is unchanged.
+
+This method is called by each worker once the input file is read, and only the
+first call of the run builds the order.
+*/
+void EventScheduler::PrepareRun(InputReader* inputReader, G4int numberOfPrimaries)
+{
+  G4AutoLock lock(&schedulerMutex);
+  if (fPrepared) return;
+  fPrepared = true;
+
+  fOrder.clear();
+  fRemaining.clear();
+  fBins.clear();
+  fEnergies.clear();
+  fCursor = 0;
+  fNumberOfDispatched = 0;
+  fNextReorder = fReorderInterval;
+  fBinTimes.assign(fNumberOfEnergyBins, 0.);
+  fBinCounts.assign(fNumberOfEnergyBins, 0);
+  fTotalTime = 0.;
+  fTotalEnergy = 0.;
+
+  G4int numberOfMacroParticles = inputReader->GetNumberOfMacroParticles();
+  if (!fCostOrdering || numberOfMacroParticles == 0 || numberOfPrimaries <= 0) return;
+
+  // kinetic energy of each macro-particle
+  G4double mass = G4ParticleTable::GetParticleTable()
+                ->FindParticle(inputReader->GetParticleName())->GetPDGMass();
+  G4double energyMin = DBL_MAX, energyMax = 0.;
+  for (G4int id=0; id<numberOfMacroParticles; id++)
+  {
+    G4double p = inputReader->GetMacroParticleMomentum(id).mag();
+    G4double energy = std::sqrt(p*p + mass*mass) - mass;
+    fEnergies.push_back(energy);
+    if (energy > 0.) energyMin = std::min(energyMin, energy);
+    energyMax = std::max(energyMax, energy);
+  }
+
+  // logarithmic energy bins over the input range
+  G4double logRange = (energyMax > energyMin) ? std::log(energyMax/energyMin) : 1.;
+  for (G4int id=0; id<numberOfMacroParticles; id++)
+  {
+    G4int bin = (fEnergies[id] > energyMin)
+              ? (G4int)(fNumberOfEnergyBins * std::log(fEnergies[id]/energyMin) / logRange) : 0;
+    fBins.push_back(std::min(bin, fNumberOfEnergyBins - 1));
+  }
+
+  // number of uses of each macro-particle
+  fRemaining.assign(numberOfMacroParticles, numberOfPrimaries / numberOfMacroParticles);
+  std::vector<G4int> ids(numberOfMacroParticles);
+  for (G4int id=0; id<numberOfMacroParticles; id++) ids[id] = id;
+  G4int remainder = numberOfPrimaries % numberOfMacroParticles;
+  for (G4int i=0; i<remainder; i++)
+  {
+    G4int j = i + (G4int)(G4UniformRand() * (numberOfMacroParticles - i));
+    std::swap(ids[i], ids[std::min(j, numberOfMacroParticles - 1)]);
+    fRemaining[ids[i]]++;
+  }
+
+  for (G4int id=0; id<numberOfMacroParticles; id++)
+  {
+    if (fRemaining[id] > 0) fOrder.push_back(id);
+  }
+  SortRemainingMacroParticles();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Fill the macro-particles of the next event, and time the previous one.
+
+The size of `ids` is the number of primaries of the event. The macro-particles
+are picked at random, or in the order of decreasing cost. The time between two
+calls on the same thread is the time of the event.
+
+This method is called by each worker at the beginning of each event.
+*/
+void EventScheduler::NextMacroParticles(G4int numberOfMacroParticles, std::vector<G4int>& ids)
+{
+  Tallies& tallies = fThreadTallies.Get();
+
+  G4double eventTime = -1.;
+  if (!tallies.currentIds.empty())
+  {
+    tallies.eventTimer.Stop();
+    eventTime = tallies.eventTimer.GetRealElapsed();
+    tallies.busyTime += eventTime;
+  }
+
+  std::fill(ids.begin(), ids.end(), -1);
+  if (fCostOrdering)
+  {
+    G4AutoLock lock(&schedulerMutex);
+    if (eventTime >= 0.) ScoreEventTime(tallies.currentIds, eventTime);
+    for (G4int& id : ids) id = PopMacroParticle();
+  }
+  for (G4int& id : ids)
+  {
+    if (id < 0) id = std::floor(G4UniformRand() * numberOfMacroParticles);
+  }
+
+  tallies.currentIds = ids;
+  tallies.numberOfEvents++;
+  tallies.eventTimer.Start();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the most expensive macro-particle left, or -1 if none.
+
+The remaining macro-particles are sorted again with the measured costs after
+fReorderInterval primaries, then each time the number of dispatched primaries
+doubles.
+The caller must hold the scheduler mutex.
+*/
+G4int EventScheduler::PopMacroParticle()
+{
+  while (fCursor < fOrder.size() && fRemaining[fOrder[fCursor]] == 0) fCursor++;
+  if (fCursor >= fOrder.size()) return -1;
+
+  G4int id = fOrder[fCursor];
+  fRemaining[id]--;
+  fNumberOfDispatched++;
+
+  if (fNumberOfDispatched == fNextReorder)
+  {
+    SortRemainingMacroParticles();
+    fNextReorder *= 2;
+  }
+  return id;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a measured event time to the energy bins of its macro-particles.
+
+The time is shared equally between the primaries of the event.
+The caller must hold the scheduler mutex.
+*/
+void EventScheduler::ScoreEventTime(const std::vector<G4int>& ids, G4double eventTime)
+{
+  G4double primaryTime = eventTime / ids.size();
+  for (G4int id : ids)
+  {
+    if (id >= (G4int)fBins.size()) continue;
+    fBinTimes[fBins[id]] += primaryTime;
+    fBinCounts[fBins[id]]++;
+    fTotalTime += primaryTime;
+    fTotalEnergy += fEnergies[id];
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Sort the remaining macro-particles by decreasing estimated cost.
+
+The cost of a macro-particle is the mean measured time of its energy bin, or
+proportional to its kinetic energy when the bin has no measurement yet.
+*/
+void EventScheduler::SortRemainingMacroParticles()
+{
+  G4double timePerEnergy = (fTotalEnergy > 0.) ? fTotalTime/fTotalEnergy : 1.;
+
+  std::vector<G4double> costs(fEnergies.size());
+  for (size_t id=0; id<fEnergies.size(); id++)
+  {
+    G4int bin = fBins[id];
+    costs[id] = (fBinCounts[bin] > 0) ? fBinTimes[bin]/fBinCounts[bin]
+                                      : fEnergies[id] * timePerEnergy;
+  }
+
+  std::stable_sort(fOrder.begin() + fCursor, fOrder.end(),
+                   [&costs](G4int a, G4int b) {return costs[a] > costs[b];});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Time the last event of the thread and save the thread report.
+
+This method is called by each worker at the end of the run.
+*/
+void EventScheduler::MergeThreadTallies()
+{
+  Tallies& tallies = fThreadTallies.Get();
+
+  G4AutoLock lock(&schedulerMutex);
+  if (!tallies.currentIds.empty())
+  {
+    tallies.eventTimer.Stop();
+    G4double eventTime = tallies.eventTimer.GetRealElapsed();
+    tallies.busyTime += eventTime;
+    if (fCostOrdering) ScoreEventTime(tallies.currentIds, eventTime);
+  }
+
+  std::pair<G4long,G4double>& report = fThreadReports[G4Threading::G4GetThreadId()];
+  report.first  += tallies.numberOfEvents;
+  report.second += tallies.busyTime;
+  lock.unlock();
+
+  // reset thread tallies for the next run
+  tallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the busy and idle time of each thread.
+
+The idle time is the difference between the wall time of the run and the time
+spent in events, and the load imbalance is the ratio between the maximum and
+the mean busy time.
+
+This method is called by the master at the end of each run.
+*/
+void EventScheduler::EndOfRun(G4double wallTime)
+{
+  if (fThreadReports.empty()) return;
+
+  G4double maxBusyTime = 0., sumBusyTime = 0.;
+  G4cout << G4endl
+         << "--------------------Event scheduling------------------------------" << G4endl
+         << " Cost ordering : " << (fCostOrdering ? "on" : "off") << G4endl
+         << " thread    events      busy (s)      idle (s)" << G4endl;
+  for (const auto& it : fThreadReports)
+  {
+    G4double busyTime = it.second.second;
+    G4cout << std::setw(7)  << it.first
+           << std::setw(10) << it.second.first
+           << std::setw(14) << busyTime
+           << std::setw(14) << std::max(0., wallTime - busyTime) << G4endl;
+    maxBusyTime = std::max(maxBusyTime, busyTime);
+    sumBusyTime += busyTime;
+  }
+  G4double meanBusyTime = sumBusyTime / fThreadReports.size();
+  G4cout << " Load imbalance (max/mean busy time) : "
+         << (meanBusyTime > 0. ? maxBusyTime/meanBusyTime : 1.) << G4endl
+         << "-----------------------------------------------------------------" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/scheduler/setCostOrdering flag
+/scheduler/setEnergyBins number
+/scheduler/setReorderInterval number
+/scheduler/setEventSeed seed
+*/
+void EventScheduler::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/scheduler/","Manage the order of the input macro-particles");
+
+  // define commands
+  G4GenericMessenger::Command& setCostOrderingCmd
+    = fMessenger->DeclareProperty("setCostOrdering",
+                                fCostOrdering,
+                                "Dispatch the most expensive macro-particles first");
+
+  G4GenericMessenger::Command& setEnergyBinsCmd
+    = fMessenger->DeclareProperty("setEnergyBins",
+                                fNumberOfEnergyBins,
+                                "Set the number of logarithmic energy bins of the cost estimate");
+
+  G4GenericMessenger::Command& setReorderIntervalCmd
+    = fMessenger->DeclareProperty("setReorderInterval",
+                                fReorderInterval,
+                                "Set the number of primaries before the first refinement of the order");
+
+  G4GenericMessenger::Command& setEventSeedCmd
+    = fMessenger->DeclareProperty("setEventSeed",
+                                fEventSeed,
+                                "Reseed each event from this seed and its global index, independently of the threads (0 to disable)");
+
+  // set commands properties
+  setCostOrderingCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setEnergyBinsCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setReorderIntervalCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setEventSeedCmd.SetStates(G4State_PreInit,G4State_Idle);
+
+  setCostOrderingCmd.SetParameterName("flag",true);
+  setCostOrderingCmd.SetDefaultValue("true");
+
+  setEnergyBinsCmd.SetParameterName("bins",false);
+  setEnergyBinsCmd.SetRange("bins>0");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
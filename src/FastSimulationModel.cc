@@ -0,0 +1,296 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file FastSimulationModel.cc
+/// \brief Implementation of the FastSimulationModel class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "FastSimulationModel.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Material.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Attach the model to the given envelope region.
+
+*/
+FastSimulationModel::FastSimulationModel(G4String modelName, G4Region* envelope)
+: G4VFastSimulationModel(modelName, envelope),
+  fElectron(nullptr),
+  fPositron(nullptr),
+  fGamma(nullptr),
+  fEmCalculator(),
+  fNumberOfBins(200),
+  fEnergyMin(1.*keV),
+  fEnergyMax(10.*GeV),
+  fNumberOfCalls(0)
+{
+  fElectron = G4Electron::Electron();
+  fPositron = G4Positron::Positron();
+  fGamma    = G4Gamma::Gamma();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Do nothing.
+
+*/
+FastSimulationModel::~FastSimulationModel()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief The model handles e-, e+ and gamma.
+
+*/
+G4bool FastSimulationModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return (&particle == fElectron || &particle == fPositron || &particle == fGamma);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Trigger the model unless the particle is leaving the layer.
+
+*/
+G4bool FastSimulationModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  return !fastTrack.OnTheBoundaryButExiting();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Move the particle to the layer exit along its direction.
+
+*/
+void FastSimulationModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  fNumberOfCalls++;
+
+  // Distance to the layer exit along the particle direction
+  G4double distance = fastTrack.GetEnvelopeSolid()->DistanceToOut(fastTrack.GetPrimaryTrackLocalPosition(),
+                                                                   fastTrack.GetPrimaryTrackLocalDirection());
+
+  if (fastTrack.GetPrimaryTrack()->GetDefinition() == fGamma)
+  {
+    DoItGamma(fastTrack, fastStep, distance);
+  }
+  else
+  {
+    DoItCharged(fastTrack, fastStep, distance);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Continuous energy loss and multiple scattering deflection of e- and e+.
+
+The exit energy is obtained from the residual CSDA range, and the deflection
+angle is sampled from a gaussian of width given by the Highland formula.
+*/
+void FastSimulationModel::DoItCharged(const G4FastTrack& fastTrack, G4FastStep& fastStep, G4double distance)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  const G4Material* material = track->GetMaterial();
+  G4double energy = track->GetKineticEnergy();
+
+  const MaterialTables& tables = GetTables(material);
+  const std::vector<G4double>& range = (track->GetDefinition() == fElectron) ? tables.electronRange
+                                                                             : tables.positronRange;
+
+  // Stop the particle if its range is shorter than the distance to the exit
+  G4double residualRange = GetTableValue(range, energy) - distance;
+  if (residualRange <= 0.)
+  {
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposeTotalEnergyDeposited(energy);
+    return;
+  }
+  G4double exitEnergy = std::min(GetEnergyFromRange(range, residualRange), energy);
+
+  // Highland multiple scattering angle, with the mean energy in the layer
+  G4double mass       = track->GetDefinition()->GetPDGMass();
+  G4double meanEnergy = 0.5 * (energy + exitEnergy);
+  G4double p          = std::sqrt(meanEnergy * (meanEnergy + 2.*mass));
+  G4double beta       = p / (meanEnergy + mass);
+  G4double x          = distance / material->GetRadlen();
+  G4double theta0     = 0.;
+  if (x > 0.)
+  {
+    theta0 = 13.6*MeV / (beta * p) * std::sqrt(x) * std::max(1. + 0.038 * std::log(x / (beta*beta)), 0.);
+  }
+
+  // Sample the deflection
+  G4double theta = theta0 * std::sqrt(-2. * std::log(1. - G4UniformRand()));
+  G4double phi   = twopi * G4UniformRand();
+  G4ThreeVector localDirection = fastTrack.GetPrimaryTrackLocalDirection();
+  G4ThreeVector exitDirection(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta));
+  exitDirection.rotateUz(localDirection);
+
+  // Move the particle to the exit
+  fastStep.ProposePrimaryTrackFinalPosition(fastTrack.GetPrimaryTrackLocalPosition() + distance * localDirection);
+  fastStep.ProposePrimaryTrackFinalMomentumDirection(exitDirection);
+  fastStep.ProposePrimaryTrackFinalKineticEnergy(exitEnergy);
+  fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + distance / (beta * c_light));
+  fastStep.ProposePrimaryTrackPathLength(distance);
+  fastStep.ProposeTotalEnergyDeposited(energy - exitEnergy);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Transmission or absorption of photons.
+
+*/
+void FastSimulationModel::DoItGamma(const G4FastTrack& fastTrack, G4FastStep& fastStep, G4double distance)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+
+  G4double attenuationLength = GetTableValue(GetTables(track->GetMaterial()).gammaAttenuation, energy);
+
+  if (G4UniformRand() < std::exp(-distance / attenuationLength))
+  {
+    // Transmission without interaction
+    fastStep.ProposePrimaryTrackFinalPosition(fastTrack.GetPrimaryTrackLocalPosition()
+                                              + distance * fastTrack.GetPrimaryTrackLocalDirection());
+    fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + distance / c_light);
+    fastStep.ProposePrimaryTrackPathLength(distance);
+  }
+  else
+  {
+    // Absorption
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposeTotalEnergyDeposited(energy);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the tables of the given material, computing them at first call.
+
+Tables are computed during the run, when the physics tables are available.
+*/
+const FastSimulationModel::MaterialTables& FastSimulationModel::GetTables(const G4Material* material)
+{
+  auto it = fTables.find(material);
+  if (it != fTables.end()) return it->second;
+
+  MaterialTables& tables = fTables[material];
+  tables.electronRange = ComputeRangeTable(fElectron, material);
+  tables.positronRange = ComputeRangeTable(fPositron, material);
+
+  tables.gammaAttenuation.resize(fNumberOfBins);
+  for (G4int i=0; i<fNumberOfBins; i++)
+  {
+    G4double energy = fEnergyMin * std::pow(fEnergyMax/fEnergyMin, (G4double)i/(fNumberOfBins-1));
+    tables.gammaAttenuation[i] = fEmCalculator.ComputeGammaAttenuationLength(energy, material);
+  }
+
+  G4cout << GetName() << " : tables computed for " << material->GetName() << G4endl;
+  return tables;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Compute the CSDA range table by integrating the inverse total stopping power.
+
+*/
+std::vector<G4double> FastSimulationModel::ComputeRangeTable(const G4ParticleDefinition* particle, const G4Material* material)
+{
+  std::vector<G4double> range(fNumberOfBins);
+
+  G4double previousEnergy = fEnergyMin;
+  G4double previousDEDX   = fEmCalculator.ComputeTotalDEDX(previousEnergy, particle, material);
+  range[0] = (previousDEDX > 0.) ? previousEnergy / previousDEDX : 0.;
+
+  for (G4int i=1; i<fNumberOfBins; i++)
+  {
+    G4double energy = fEnergyMin * std::pow(fEnergyMax/fEnergyMin, (G4double)i/(fNumberOfBins-1));
+    G4double dedx   = fEmCalculator.ComputeTotalDEDX(energy, particle, material);
+    range[i] = range[i-1] + 0.5 * (energy - previousEnergy) * (1./previousDEDX + 1./dedx);
+    previousEnergy = energy;
+    previousDEDX   = dedx;
+  }
+
+  return range;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Interpolate a table linearly in log(energy).
+
+*/
+G4double FastSimulationModel::GetTableValue(const std::vector<G4double>& table, G4double energy) const
+{
+  if (energy <= fEnergyMin) return table.front() * energy / fEnergyMin;
+  if (energy >= fEnergyMax) return table.back();
+
+  G4double position = (fNumberOfBins-1) * std::log(energy/fEnergyMin) / std::log(fEnergyMax/fEnergyMin);
+  G4int i = std::min((G4int)position, fNumberOfBins-2);
+  G4double f = position - i;
+  return (1.-f) * table[i] + f * table[i+1];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Invert a range table by binary search.
+
+*/
+G4double FastSimulationModel::GetEnergyFromRange(const std::vector<G4double>& range, G4double residualRange) const
+{
+  if (residualRange <= range.front()) return fEnergyMin * residualRange / range.front();
+  if (residualRange >= range.back()) return fEnergyMax;
+
+  G4int i = std::upper_bound(range.begin(), range.end(), residualRange) - range.begin() - 1;
+  G4double f = (residualRange - range[i]) / (range[i+1] - range[i]);
+  G4double logEnergy = std::log(fEnergyMin) + (i + f) * std::log(fEnergyMax/fEnergyMin) / (fNumberOfBins-1);
+  return std::exp(logEnergy);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -46,7 +46,12 @@ InputReader::InputReader(Units* units)
 : fMessenger(nullptr),
   fUnits(units),
   fInputFileName(""),
-  fParticleName("geantino")
+  fLoadedFileName(""),
+  fParticleName("geantino"),
+  fParticleDefinition(nullptr),
+  fPrimariesPerEvent(1),
+  fShardIndex(0),
+  fNumberOfShards(1)
 {
   SetCommands();
 }
@@ -74,12 +79,23 @@ w   x   y   z   px  py  pz  t
 w   x   y   z   px  py  pz  t
 
 with separators being spaces.
+
+The macro-particles are kept in memory for the next runs, and the file is only
+read again if its name is given again with /input/setFileName.
+
+In shard mode, only the contiguous slice of rows of the shard is kept, so that
+the union of all the shards uses each row of the file once.
+
+Each worker reads its own copy, so that with /run/pinAffinity the pages of the
+arrays are allocated on the NUMA node of the worker at the first touch.
 */
 void InputReader::ReadInputFile()
 {
+  // Keep the macro-particles already in memory
+  if (fInputFileName == fLoadedFileName && !fRawW.empty()) return;
 
   // Clear fW,fX,... before import
-  fW.clear()    ;
+  fW.clear()    ; fRawW.clear();
   fX.clear()    ; fY.clear()  ; fZ.clear();
   fPx.clear()   ; fPy.clear() ; fPz.clear();
   fT.clear()    ;
@@ -113,6 +129,28 @@ void InputReader::ReadInputFile()
     fT.push_back(t*tUnit)   ;
   }
   input.close();
+
+  // Keep the rows of the shard
+  if (fNumberOfShards > 1)
+  {
+    size_t numberOfRows = fW.size();
+    size_t first = numberOfRows * fShardIndex / fNumberOfShards;
+    size_t last  = numberOfRows * (fShardIndex + 1) / fNumberOfShards;
+    for (std::vector<G4double>* column : {&fW,&fX,&fY,&fZ,&fPx,&fPy,&fPz,&fT})
+    {
+      *column = std::vector<G4double>(column->begin() + first, column->begin() + last);
+    }
+    G4cout << "Shard " << fShardIndex << "/" << fNumberOfShards << " : input rows "
+           << first << " to " << last << " of " << numberOfRows << G4endl;
+    if (fW.empty())
+    {
+      G4cerr << "No input row left for shard " << fShardIndex << ", use less shards" << G4endl;
+      throw;
+    }
+  }
+
+  fRawW = fW;
+  fLoadedFileName = fInputFileName;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -120,14 +158,16 @@ void InputReader::ReadInputFile()
 /**
 \brief Normalize macro-particles weights in order to conserve total number of particles
 
+The weights are computed from the raw input weights, so that each run can use
+a different number of events. Each event contains fPrimariesPerEvent primaries.
 */
 void InputReader::NormalizeMacroParticlesWeights(G4int NumberOfEventsToBeProcessed)
 {
   G4int NumberOfMacroParticles = fW.size();
-  G4double normW = (G4double)NumberOfEventsToBeProcessed/(G4double)NumberOfMacroParticles;
+  G4double normW = (G4double)NumberOfEventsToBeProcessed*fPrimariesPerEvent/(G4double)NumberOfMacroParticles;
   for (int i=0; i<NumberOfMacroParticles; i++)
   {
-    fW[i] = fW[i]/normW;
+    fW[i] = fRawW[i]/normW;
   }
 }
 
@@ -140,6 +180,7 @@ void InputReader::NormalizeMacroParticlesWeights(G4int NumberOfEventsToBeProcess
 The input file name can be changed by using
 /input/setFileName fileName
 /input/setParticle particleName
+/input/setPrimariesPerEvent number
 
 */
 void InputReader::SetCommands()
@@ -158,7 +199,13 @@ void InputReader::SetCommands()
                               &InputReader::SetParticleName,
                               "Change particle type");
 
+  G4GenericMessenger::Command& setPrimariesPerEventCmd
+    = fMessenger->DeclareMethod("setPrimariesPerEvent",
+                              &InputReader::SetPrimariesPerEvent,
+                              "Change the number of primaries generated in each event");
+
   // set commands properties
   setParticleNameCmd.SetStates(G4State_Idle);
   setInputFileNameCmd.SetStates(G4State_Idle);
+  setPrimariesPerEventCmd.SetStates(G4State_Idle);
 }
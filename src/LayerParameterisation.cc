@@ -0,0 +1,140 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file LayerParameterisation.cc
+/// \brief Implementation of the LayerParameterisation class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "LayerParameterisation.hh"
+
+#include "G4VPhysicalVolume.hh"
+#include "G4Tubs.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <sstream>
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Store the period and compute the layer centers inside a period.
+
+*/
+LayerParameterisation::LayerParameterisation(const std::vector<G4Material*>& materials,
+                                             const std::vector<G4double>& widths,
+                                             G4int numberOfPeriods)
+: G4VPVParameterisation(),
+  fMaterials(materials),
+  fWidths(widths),
+  fPeriodWidth(0.),
+  fNumberOfPeriods(numberOfPeriods)
+{
+  for (G4double width : fWidths)
+  {
+    fCenters.push_back(fPeriodWidth + width/2.);
+    fPeriodWidth += width;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Do nothing.
+
+*/
+LayerParameterisation::~LayerParameterisation()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Place the layer along the z axis of the stack envelope.
+
+The copy 0 is at the -z end of the envelope, which is rotated so that it is the
+first layer hit by the beam.
+*/
+void LayerParameterisation::ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const
+{
+  G4int period = copyNo / fWidths.size();
+  G4int layer  = copyNo % fWidths.size();
+
+  G4double z = -GetTotalWidth()/2. + period * fPeriodWidth + fCenters[layer];
+  physVol->SetTranslation(G4ThreeVector(0., 0., z));
+  physVol->SetRotation(nullptr);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the half length of the shared layer solid.
+
+*/
+void LayerParameterisation::ComputeDimensions(G4Tubs& layerS, const G4int copyNo, const G4VPhysicalVolume*) const
+{
+  layerS.SetZHalfLength(fWidths[copyNo % fWidths.size()]/2.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the material of the layer.
+
+*/
+G4Material* LayerParameterisation::ComputeMaterial(const G4int copyNo, G4VPhysicalVolume*, const G4VTouchable*)
+{
+  return fMaterials[copyNo % fMaterials.size()];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the width of the thickest layer of the period.
+
+*/
+G4double LayerParameterisation::GetMaximumWidth() const
+{
+  return *std::max_element(fWidths.begin(), fWidths.end());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return a description of the period, used to identify cached results.
+
+*/
+G4String LayerParameterisation::GetConfiguration() const
+{
+  std::ostringstream configuration;
+  configuration.precision(12);
+  configuration << "periods " << fNumberOfPeriods;
+  for (size_t layer=0; layer<fWidths.size(); layer++)
+  {
+    configuration << " " << fMaterials[layer]->GetName() << " " << fWidths[layer]/um;
+  }
+  return configuration.str();
+}
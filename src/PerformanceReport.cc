@@ -0,0 +1,353 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PerformanceReport.cc
+/// \brief Implementation of the PerformanceReport class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "PerformanceReport.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4Positron.hh"
+#include "G4AutoLock.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace
+{
+  G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+
+  /** \brief Number of values of each phase space row.*/
+  const G4int numberOfColumns = 8;
+
+  /** \brief Name of the species columns.*/
+  const char* speciesNames[] = {"e-", "gamma", "e+", "other"};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Get particles definition and call SetCommands.
+
+*/
+PerformanceReport::PerformanceReport()
+: fMessenger(nullptr),
+  fElectron(nullptr),
+  fGamma(nullptr),
+  fPositron(nullptr),
+  fEnabled(false),
+  fNumberOfSpecies(4),
+  fFileName("performance.json"),
+  fShardSuffix("")
+{
+  fElectron = G4Electron::Electron();
+  fGamma    = G4Gamma::Gamma();
+  fPositron = G4Positron::Positron();
+
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+PerformanceReport::~PerformanceReport()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the species column of the given particle.
+
+*/
+G4int PerformanceReport::GetSpeciesIndex(const G4ParticleDefinition* particle) const
+{
+  if (particle == fElectron) return 0;
+  if (particle == fGamma)    return 1;
+  if (particle == fPositron) return 2;
+  return 3;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the name of the layer of the given cell, `world` outside the target.
+
+*/
+G4String PerformanceReport::GetLayerName(G4int cell) const
+{
+  G4int layer = cell / fNumberOfSpecies - 1;
+  return (layer < 0) ? G4String("world") : G4String(std::to_string(layer));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the merged tallies.
+
+This method is called by the master at the beginning of each run.
+*/
+void PerformanceReport::BeginOfRun()
+{
+  fMergedTallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Start timing the generation of the primaries of an event.
+
+*/
+void PerformanceReport::BeginGeneration()
+{
+  if (!fEnabled) return;
+  fThreadTallies.Get().generationStart = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Stop timing the generation, and start timing the steps of the event.
+
+*/
+void PerformanceReport::EndGeneration()
+{
+  if (!fEnabled) return;
+  Tallies& tallies = fThreadTallies.Get();
+  tallies.lastStamp = Clock::now();
+  tallies.generationTime += std::chrono::duration<G4double>(tallies.lastStamp - tallies.generationStart).count();
+  tallies.numberOfEvents++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Count a step and give it the time since the last stamp of the thread.
+
+A steady clock is used, as it is read at each step.
+*/
+void PerformanceReport::ScoreStep(G4int layer, const G4ParticleDefinition* particle, G4bool newTrack)
+{
+  if (!fEnabled) return;
+  Tallies& tallies = fThreadTallies.Get();
+  Clock::time_point now = Clock::now();
+
+  G4int cell = GetCellIndex(std::max(layer, -1), GetSpeciesIndex(particle));
+  if (cell >= (G4int)tallies.steps.size())
+  {
+    tallies.steps.resize(cell+1, 0);
+    tallies.stepTimes.resize(cell+1, 0.);
+  }
+  tallies.steps[cell]++;
+  tallies.stepTimes[cell] += std::chrono::duration<G4double>(now - tallies.lastStamp).count();
+  tallies.lastStamp = now;
+
+  if (newTrack) tallies.numberOfTracks++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Count a phase space row, recorded since the last step of the thread.
+
+*/
+void PerformanceReport::ScoreRecord()
+{
+  if (!fEnabled) return;
+  Tallies& tallies = fThreadTallies.Get();
+  Clock::time_point now = Clock::now();
+  tallies.fillTime += std::chrono::duration<G4double>(now - tallies.lastStamp).count();
+  tallies.lastStamp = now;
+  tallies.numberOfRecords++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the tallies of the current thread to the merged tallies.
+
+This method is called by each worker at the end of the run.
+*/
+void PerformanceReport::MergeThreadTallies()
+{
+  if (!fEnabled) return;
+  Tallies& tallies = fThreadTallies.Get();
+
+  G4AutoLock lock(&mergeMutex);
+  fMergedTallies.numberOfEvents  += tallies.numberOfEvents;
+  fMergedTallies.numberOfTracks  += tallies.numberOfTracks;
+  fMergedTallies.numberOfRecords += tallies.numberOfRecords;
+  fMergedTallies.generationTime  += tallies.generationTime;
+  fMergedTallies.fillTime        += tallies.fillTime;
+
+  if (tallies.steps.size() > fMergedTallies.steps.size())
+  {
+    fMergedTallies.steps.resize(tallies.steps.size(), 0);
+    fMergedTallies.stepTimes.resize(tallies.stepTimes.size(), 0.);
+  }
+  for (size_t cell=0; cell<tallies.steps.size(); cell++)
+  {
+    fMergedTallies.steps[cell]     += tallies.steps[cell];
+    fMergedTallies.stepTimes[cell] += tallies.stepTimes[cell];
+  }
+  lock.unlock();
+
+  // reset thread tallies for the next run
+  tallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the performance table and write the JSON file.
+
+This method is called by the master at the end of each run.
+*/
+void PerformanceReport::EndOfRun(G4double wallTime)
+{
+  const Tallies& merged = fMergedTallies;
+  if (merged.numberOfEvents == 0) return;
+
+  G4long numberOfSteps = 0;
+  G4double trackingTime = 0.;
+  for (size_t cell=0; cell<merged.steps.size(); cell++)
+  {
+    numberOfSteps += merged.steps[cell];
+    trackingTime  += merged.stepTimes[cell];
+  }
+
+  G4cout << G4endl
+         << "--------------------Performance report----------------------------" << G4endl
+         << " Events                     : " << merged.numberOfEvents
+         << " (" << merged.numberOfEvents/wallTime << " /s)" << G4endl
+         << " Tracks                     : " << merged.numberOfTracks << G4endl
+         << " Steps                      : " << numberOfSteps
+         << " (" << numberOfSteps/wallTime << " /s)" << G4endl
+         << " Records at interfaces      : " << merged.numberOfRecords << G4endl
+         << " Output payload (bytes)     : " << merged.numberOfRecords*numberOfColumns*sizeof(G4double) << G4endl
+         << " Generation time (s)        : " << merged.generationTime << G4endl
+         << " Tracking time (s)          : " << trackingTime << G4endl
+         << " Diagnostics fill time (s)  : " << merged.fillTime << G4endl
+         << G4endl
+         << "  layer species        steps     time (s)   time (%)" << G4endl;
+  for (size_t cell=0; cell<merged.steps.size(); cell++)
+  {
+    if (merged.steps[cell] == 0) continue;
+    G4cout << std::setw(7)  << GetLayerName(cell)
+           << std::setw(8)  << speciesNames[cell % fNumberOfSpecies]
+           << std::setw(13) << merged.steps[cell]
+           << std::setw(13) << merged.stepTimes[cell]
+           << std::setw(11) << 100. * merged.stepTimes[cell] / std::max(trackingTime, 1e-30) << G4endl;
+  }
+  G4cout << "-----------------------------------------------------------------" << G4endl;
+
+  if (fFileName != "") WriteJson(wallTime);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the merged counters in a JSON file.
+
+In shard mode, the shard index is inserted before the file extension.
+*/
+void PerformanceReport::WriteJson(G4double wallTime) const
+{
+  const Tallies& merged = fMergedTallies;
+
+  G4String fileName = fFileName;
+  size_t dot = fileName.rfind('.');
+  fileName.insert((dot == std::string::npos) ? fileName.size() : dot, fShardSuffix);
+
+  std::ofstream output(fileName);
+  output << "{" << G4endl;
+  output << "  \"wallTime\": " << wallTime << "," << G4endl;
+  output << "  \"events\": " << merged.numberOfEvents << "," << G4endl;
+  output << "  \"tracks\": " << merged.numberOfTracks << "," << G4endl;
+  output << "  \"records\": " << merged.numberOfRecords << "," << G4endl;
+  output << "  \"outputBytes\": " << merged.numberOfRecords*numberOfColumns*sizeof(G4double) << "," << G4endl;
+  output << "  \"generationTime\": " << merged.generationTime << "," << G4endl;
+  output << "  \"fillTime\": " << merged.fillTime << "," << G4endl;
+  output << "  \"cells\": [";
+  G4bool first = true;
+  for (size_t cell=0; cell<merged.steps.size(); cell++)
+  {
+    if (merged.steps[cell] == 0) continue;
+    output << (first ? "" : ",") << G4endl
+           << "    {\"layer\": \"" << GetLayerName(cell) << "\""
+           << ", \"species\": \"" << speciesNames[cell % fNumberOfSpecies] << "\""
+           << ", \"steps\": " << merged.steps[cell]
+           << ", \"time\": " << merged.stepTimes[cell] << "}";
+    first = false;
+  }
+  output << G4endl << "  ]" << G4endl;
+  output << "}" << G4endl;
+  output.close();
+
+  G4cout << "Performance report written in " << fileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/performance/setEnabled flag
+/performance/setFileName fileName
+*/
+void PerformanceReport::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/performance/","Manage the performance report");
+
+  // define commands
+  G4GenericMessenger::Command& setEnabledCmd
+    = fMessenger->DeclareProperty("setEnabled",
+                                  fEnabled,
+                                  "Count and time the steps, and print the performance report");
+
+  G4GenericMessenger::Command& setFileNameCmd
+    = fMessenger->DeclareMethod("setFileName",
+                                &PerformanceReport::SetFileName,
+                                "Set the JSON file of the performance report (none for no file)");
+
+  // set commands properties
+  setEnabledCmd.SetParameterName("flag",false);
+  setEnabledCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setFileNameCmd.SetStates(G4State_PreInit,G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
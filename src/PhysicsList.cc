@@ -30,10 +30,37 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 #include "PhysicsList.hh"
+#include "Hash.hh"
 
 #include "G4EmPenelopePhysics.hh"
 #include "G4EmStandardPhysics_option4.hh"
 
+#include "G4EmParameters.hh"
+#include "G4LossTableManager.hh"
+#include "G4EmConfigurator.hh"
+#include "G4UrbanMscModel.hh"
+#include "G4PhysicsListHelper.hh"
+#include "G4UserSpecialCuts.hh"
+#include "G4UserLimits.hh"
+#include "G4RegionStore.hh"
+#include "G4Region.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4ProcessManager.hh"
+#include "G4FastSimulationManagerProcess.hh"
+#include "G4Threading.hh"
+#include "G4Version.hh"
+#include "G4StateManager.hh"
+#include "G4Material.hh"
+#include "G4ProductionCuts.hh"
+#include "G4UnitsTable.hh"
+
+#include <set>
+#include <sstream>
+#include <fstream>
+#include <sys/stat.h>
+
 #include "G4SystemOfUnits.hh"
 #include "G4GenericMessenger.hh"
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -45,7 +72,15 @@
 PhysicsList::PhysicsList()
 : G4VModularPhysicsList(),
   fPhysicsList(nullptr),
-  fMessenger(nullptr)
+  fMessenger(nullptr),
+  fBremSplittingEnergyLimit(100.*TeV),
+  fDirectionalSplitting(false),
+  fDirectionalSplittingTarget(),
+  fDirectionalSplittingRadius(1.*cm),
+  fTableCacheDirectory(""),
+  fTableCacheEntry(""),
+  fTableCacheHit(false),
+  fTableCachePending(false)
 {
   // set default cut value
   SetDefaultCutValue(1.0*um);
@@ -93,6 +128,15 @@ void PhysicsList::ConstructProcess()
 
   // Electromagnetic physics list
   fPhysicsList->ConstructProcess();
+
+  // Region-specific electromagnetic parameters
+  ConstructRegionParameters();
+
+  // Fast simulation, only active in regions with a fast simulation model
+  G4FastSimulationManagerProcess* fastSimulationProcess = new G4FastSimulationManagerProcess("fastSimProcess_massGeom");
+  G4Electron::Electron()->GetProcessManager()->AddDiscreteProcess(fastSimulationProcess);
+  G4Positron::Positron()->GetProcessManager()->AddDiscreteProcess(fastSimulationProcess);
+  G4Gamma::Gamma()->GetProcessManager()->AddDiscreteProcess(fastSimulationProcess);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -109,32 +153,376 @@ void PhysicsList::SetCuts()
 
  DumpCutValuesTable();
 }
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return a description of the physics settings, used to identify cached results.
+
+*/
+G4String PhysicsList::GetConfiguration() const
+{
+  std::ostringstream configuration;
+  configuration.precision(12);
+  configuration << fPhysicsList->GetPhysicsName()
+                << " ; cut " << GetDefaultCutValue()/um
+                << " ; Geant4 " << G4VERSION_NUMBER;
+
+  for (const auto& it : fMscStepLimitTypes)       configuration << " ; mscStepLimit " << it.first << " " << it.second;
+  for (const auto& it : fMscRangeFactors)         configuration << " ; mscRangeFactor " << it.first << " " << it.second;
+  for (const auto& it : fFluorescence)            configuration << " ; fluorescence " << it.first << " " << it.second;
+  for (const auto& it : fAuger)                   configuration << " ; auger " << it.first << " " << it.second;
+  for (const auto& it : fLowestElectronEnergies)  configuration << " ; lowestElectronEnergy " << it.first << " " << it.second/MeV;
+  for (const auto& it : fBremSplittingFactors)    configuration << " ; bremSplitting " << it.first << " " << it.second;
+
+  if (!fBremSplittingFactors.empty())
+  {
+    configuration << " ; bremSplittingEnergyLimit " << fBremSplittingEnergyLimit/MeV
+                  << " ; directionalSplitting " << fDirectionalSplitting
+                  << " " << fDirectionalSplittingTarget/um << " " << fDirectionalSplittingRadius/um;
+  }
+
+  return configuration.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Manage the physics tables cache at the beginning of each run.
+
+When a run starts (Idle to Init state), the tables are retrieved from the cache
+entry of the current configuration if it exists. When the run initialization
+is done (Init to Idle state), the tables are stored in the cache if they were
+built, and the time spent is logged for cache hits and misses.
+
+This class is only registered to the master state manager, the workers using
+the master tables.
+*/
+G4bool PhysicsList::Notify(G4ApplicationState requestedState)
+{
+  if (fTableCacheDirectory == "") return true;
+
+  G4ApplicationState currentState = G4StateManager::GetStateManager()->GetCurrentState();
+
+  if (currentState == G4State_Idle && requestedState == G4State_Init)
+  {
+    // The tables are only built again when the configuration changes
+    G4String entry = fTableCacheDirectory + "/" + FormatHash(ComputeHash(GetTableCacheKey()));
+    if (entry == fTableCacheEntry) return true;
+    fTableCacheEntry = entry;
+
+    std::ifstream cutsFile(entry + "/couple.dat");
+    fTableCacheHit = (bool)cutsFile;
+    if (fTableCacheHit)
+    {
+      SetPhysicsTableRetrieved(entry);
+    }
+    else
+    {
+      ResetPhysicsTableRetrieved();
+    }
+    fTableCachePending = true;
+    fTableTimer.Start();
+  }
+  else if (currentState == G4State_Init && requestedState == G4State_Idle && fTableCachePending)
+  {
+    fTableTimer.Stop();
+    fTableCachePending = false;
+
+    if (fTableCacheHit)
+    {
+      G4cout << "Physics tables cache hit : " << fTableCacheEntry
+             << " (" << fTableTimer.GetRealElapsed() << " s)" << G4endl;
+      ResetPhysicsTableRetrieved();
+    }
+    else
+    {
+      G4cout << "Physics tables cache miss : " << fTableCacheEntry
+             << " (" << fTableTimer.GetRealElapsed() << " s)" << G4endl;
+      mkdir(fTableCacheDirectory.c_str(), 0755);
+      mkdir(fTableCacheEntry.c_str(), 0755);
+      StorePhysicsTable(fTableCacheEntry);
+    }
+  }
+
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the physics tables cache key.
+
+The key contains the physics settings and Geant4 version, the list of materials
+and the production cuts of each region.
+*/
+G4String PhysicsList::GetTableCacheKey() const
+{
+  std::ostringstream key;
+  key.precision(12);
+  key << GetConfiguration();
+
+  for (const G4Material* material : *G4Material::GetMaterialTable())
+  {
+    key << " ; material " << material->GetName() << " " << material->GetDensity()/(g/cm3);
+  }
+
+  for (const G4Region* region : *G4RegionStore::GetInstance())
+  {
+    const G4ProductionCuts* cuts = region->GetProductionCuts();
+    if (!cuts) continue;
+    key << " ; cuts " << region->GetName();
+    for (G4int i=0; i<4; i++) key << " " << cuts->GetProductionCut(i)/um;
+  }
+
+  return key.str();
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 void PhysicsList::SetPhysicsList(G4String name)
 {
   if (name == "penelope")
   {
+    delete fPhysicsList;
     fPhysicsList = new G4EmPenelopePhysics();
   }
   else if (name == "standard")
   {
+    delete fPhysicsList;
     fPhysicsList = new G4EmStandardPhysics_option4();
   }
   else
   {
     G4cerr << "Unknown physics list name : " << name << G4endl;
+    return;
   }
 
   G4cout << "Physics list has been modified to : " << name << G4endl;
 }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the multiple scattering step limitation type in a given region.
+
+Available types are minimal, safety, safetyPlus and distanceToBoundary.
+*/
+void PhysicsList::SetMscStepLimit(G4String regionName, G4String type)
+{
+  if (type == "minimal")
+  {
+    fMscStepLimitTypes[regionName] = fMinimal;
+  }
+  else if (type == "safety")
+  {
+    fMscStepLimitTypes[regionName] = fUseSafety;
+  }
+  else if (type == "safetyPlus")
+  {
+    fMscStepLimitTypes[regionName] = fUseSafetyPlus;
+  }
+  else if (type == "distanceToBoundary")
+  {
+    fMscStepLimitTypes[regionName] = fUseDistanceToBoundary;
+  }
+  else
+  {
+    G4cerr << "Unknown msc step limit type : " << type << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the multiple scattering range factor in a given region.
+
+*/
+void PhysicsList::SetMscRangeFactor(G4String regionName, G4double factor)
+{
+  if (factor > 0. && factor <= 1.)
+  {
+    fMscRangeFactors[regionName] = factor;
+  }
+  else
+  {
+    G4cerr << "Msc range factor must be in ]0,1] : " << factor << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Switch on or off the fluorescence in a given region.
+
+*/
+void PhysicsList::SetFluorescence(G4String regionName, G4bool fluorescence)
+{
+  fFluorescence[regionName] = fluorescence;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Switch on or off the Auger electron emission in a given region.
+
+*/
+void PhysicsList::SetAuger(G4String regionName, G4bool auger)
+{
+  fAuger[regionName] = auger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the lowest electron and positron kinetic energy tracked in a given region.
+
+Particles below this energy are stopped and their energy is deposited locally.
+*/
+void PhysicsList::SetLowestElectronEnergy(G4String regionName, G4double energy, G4String unit)
+{
+  if (G4UnitDefinition::GetCategory(unit) != "Energy")
+  {
+    G4cerr << "Unknown energy unit : " << unit << G4endl;
+    return;
+  }
+  fLowestElectronEnergies[regionName] = energy * G4UnitDefinition::GetValueOf(unit);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Split bremsstrahlung photons emitted in a given region.
+
+Each e-/e+ bremsstrahlung photon is replaced by `factor` photons of weight 1/factor.
+The region `world` stands for the default world region.
+*/
+void PhysicsList::SetBremSplitting(G4String regionName, G4int factor)
+{
+  if (factor >= 1)
+  {
+    fBremSplittingFactors[regionName] = factor;
+  }
+  else
+  {
+    G4cerr << "Bremsstrahlung splitting factor must be >= 1 : " << factor << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Apply the region-specific electromagnetic parameters.
+
+This method is called after the construction of the pre-packaged PhysicsList
+processes, on the master and on each worker thread.
+
+In regions with a modified multiple scattering step limitation or range factor,
+the e-/e+ msc model below 100 MeV is replaced by an Urban model with the given
+parameters, whatever the selected physics list.
+Fluorescence and Auger emission are managed by the atomic deexcitation, and the
+lowest electron energy is applied with user limits.
+
+Bremsstrahlung splitting relies on the EM secondary biasing : the weights of the
+split photons are carried by the tracks, and then exported by the Diagnostics.
+With directional splitting, only the photons emitted toward the sphere of interest
+are split, the others are played with Russian roulette.
+*/
+void PhysicsList::ConstructRegionParameters()
+{
+  G4EmParameters* emParameters = G4EmParameters::Instance();
+  G4EmConfigurator* emConfigurator = G4LossTableManager::Instance()->EmConfigurator();
+
+  // Multiple scattering
+  std::set<G4String> mscRegions;
+  for (const auto& it : fMscStepLimitTypes) mscRegions.insert(it.first);
+  for (const auto& it : fMscRangeFactors)   mscRegions.insert(it.first);
+
+  const char* chargedParticles[] = {"e-", "e+"};
+  for (const G4String& regionName : mscRegions)
+  {
+    for (const char* particleName : chargedParticles)
+    {
+      G4UrbanMscModel* msc = new G4UrbanMscModel();
+      if (fMscStepLimitTypes.count(regionName)) msc->SetStepLimitType(fMscStepLimitTypes[regionName]);
+      if (fMscRangeFactors.count(regionName))   msc->SetRangeFactor(fMscRangeFactors[regionName]);
+      // Prevent global parameters from overriding the regional ones
+      msc->SetLocked(true);
+      emConfigurator->SetExtraEmModel(particleName, "msc", msc, regionName, 0., 100.*MeV);
+    }
+  }
+
+  // Atomic deexcitation
+  std::set<G4String> deexRegions;
+  for (const auto& it : fFluorescence) deexRegions.insert(it.first);
+  for (const auto& it : fAuger)        deexRegions.insert(it.first);
+
+  for (const G4String& regionName : deexRegions)
+  {
+    G4bool fluorescence = fFluorescence.count(regionName) ? fFluorescence[regionName] : emParameters->Fluo();
+    G4bool auger        = fAuger.count(regionName)        ? fAuger[regionName]        : emParameters->Auger();
+    emParameters->SetDeexActiveRegion(regionName, fluorescence, auger, emParameters->Pixe());
+  }
+
+  // Bremsstrahlung splitting
+  for (const auto& it : fBremSplittingFactors)
+  {
+    emParameters->ActivateSecondaryBiasing("eBrem", it.first, it.second, fBremSplittingEnergyLimit);
+  }
+
+  if (fDirectionalSplitting)
+  {
+#if G4VERSION_NUMBER >= 1070
+    emParameters->SetDirectionalSplitting(true);
+    emParameters->SetDirectionalSplittingTarget(fDirectionalSplittingTarget);
+    emParameters->SetDirectionalSplittingRadius(fDirectionalSplittingRadius);
+#else
+    G4cerr << "Directional splitting requires Geant4 10.7 or later, uniform splitting is used" << G4endl;
+#endif
+  }
+
+  // Lowest electron energy
+  if (!fLowestElectronEnergies.empty())
+  {
+    G4PhysicsListHelper* helper = G4PhysicsListHelper::GetPhysicsListHelper();
+    helper->RegisterProcess(new G4UserSpecialCuts(), G4Electron::Electron());
+    helper->RegisterProcess(new G4UserSpecialCuts(), G4Positron::Positron());
+
+    // Regions and user limits are shared between threads
+    if (G4Threading::IsMasterThread())
+    {
+      for (const auto& it : fLowestElectronEnergies)
+      {
+        G4Region* region = G4RegionStore::GetInstance()->FindOrCreateRegion(it.first);
+        region->SetUserLimits(new G4UserLimits(DBL_MAX, DBL_MAX, DBL_MAX, it.second));
+      }
+    }
+  }
+}
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 /**
 \brief Set commands to be interpreted with the UI
 
-The setPhysicsList function can be called in UI in the following way :
+The physics list must be chosen before /run/initialize, since the processes
+are constructed at the kernel initialization :
 
 /physics/setPhysicsList str
+
+Region-specific EM parameters must be defined before /run/initialize :
+
+/physics/setMscStepLimit regionName type
+/physics/setMscRangeFactor regionName factor
+/physics/setFluorescence regionName bool
+/physics/setAuger regionName bool
+/physics/setLowestElectronEnergy regionName value unit
+/physics/setBremSplitting regionName factor
+/physics/setBremSplittingEnergyLimit value unit
+/physics/setDirectionalSplitting bool
+/physics/setDirectionalSplittingTarget x y z unit
+/physics/setDirectionalSplittingRadius value unit
+
+The physics tables are stored in and retrieved from a cache directory with :
+
+/physics/setTableCacheDirectory directory
 */
 void PhysicsList::SetCommands()
 {
@@ -147,8 +535,81 @@ void PhysicsList::SetCommands()
                                 &PhysicsList::SetPhysicsList,
                                 "Change physics list");
 
+  G4GenericMessenger::Command& setMscStepLimitCmd
+    = fMessenger->DeclareMethod("setMscStepLimit",
+                                &PhysicsList::SetMscStepLimit,
+                                "Set msc step limitation type (minimal, safety, safetyPlus, distanceToBoundary) in a region");
+
+  G4GenericMessenger::Command& setMscRangeFactorCmd
+    = fMessenger->DeclareMethod("setMscRangeFactor",
+                                &PhysicsList::SetMscRangeFactor,
+                                "Set msc range factor in a region");
+
+  G4GenericMessenger::Command& setFluorescenceCmd
+    = fMessenger->DeclareMethod("setFluorescence",
+                                &PhysicsList::SetFluorescence,
+                                "Switch on/off fluorescence in a region");
+
+  G4GenericMessenger::Command& setAugerCmd
+    = fMessenger->DeclareMethod("setAuger",
+                                &PhysicsList::SetAuger,
+                                "Switch on/off Auger electron emission in a region");
+
+  G4GenericMessenger::Command& setLowestElectronEnergyCmd
+    = fMessenger->DeclareMethod("setLowestElectronEnergy",
+                                &PhysicsList::SetLowestElectronEnergy,
+                                "Set lowest e-/e+ kinetic energy tracked in a region");
+
+  G4GenericMessenger::Command& setBremSplittingCmd
+    = fMessenger->DeclareMethod("setBremSplitting",
+                                &PhysicsList::SetBremSplitting,
+                                "Set bremsstrahlung splitting factor in a region (world for the world region)");
+
+  G4GenericMessenger::Command& setBremSplittingEnergyLimitCmd
+    = fMessenger->DeclarePropertyWithUnit("setBremSplittingEnergyLimit",
+                                "MeV",
+                                fBremSplittingEnergyLimit,
+                                "Do not split bremsstrahlung photons above this energy");
+
+  G4GenericMessenger::Command& setDirectionalSplittingCmd
+    = fMessenger->DeclareProperty("setDirectionalSplitting",
+                                fDirectionalSplitting,
+                                "Split only bremsstrahlung photons emitted toward the sphere of interest");
+
+  G4GenericMessenger::Command& setDirectionalSplittingTargetCmd
+    = fMessenger->DeclarePropertyWithUnit("setDirectionalSplittingTarget",
+                                "mm",
+                                fDirectionalSplittingTarget,
+                                "Set center of the directional splitting sphere of interest");
+
+  G4GenericMessenger::Command& setDirectionalSplittingRadiusCmd
+    = fMessenger->DeclarePropertyWithUnit("setDirectionalSplittingRadius",
+                                "mm",
+                                fDirectionalSplittingRadius,
+                                "Set radius of the directional splitting sphere of interest");
+
+  G4GenericMessenger::Command& setTableCacheDirectoryCmd
+    = fMessenger->DeclareProperty("setTableCacheDirectory",
+                                fTableCacheDirectory,
+                                "Store and retrieve physics tables in the given directory");
+
   // set commands properties
-  setPhysicsListCmd.SetStates(G4State_Idle);
+  setPhysicsListCmd.SetStates(G4State_PreInit);
+  setTableCacheDirectoryCmd.SetStates(G4State_PreInit, G4State_Idle);
+  setMscStepLimitCmd.SetStates(G4State_PreInit);
+  setMscRangeFactorCmd.SetStates(G4State_PreInit);
+  setFluorescenceCmd.SetStates(G4State_PreInit);
+  setAugerCmd.SetStates(G4State_PreInit);
+  setLowestElectronEnergyCmd.SetStates(G4State_PreInit);
+  setLowestElectronEnergyCmd.SetParameterName(1, "energy", false);
+  setLowestElectronEnergyCmd.SetParameterName(2, "unit", true);
+  setLowestElectronEnergyCmd.SetDefaultValue(2, "MeV");
+  setLowestElectronEnergyCmd.SetRange("energy>=0.");
+  setBremSplittingCmd.SetStates(G4State_PreInit);
+  setBremSplittingEnergyLimitCmd.SetStates(G4State_PreInit);
+  setDirectionalSplittingCmd.SetStates(G4State_PreInit);
+  setDirectionalSplittingTargetCmd.SetStates(G4State_PreInit);
+  setDirectionalSplittingRadiusCmd.SetStates(G4State_PreInit);
 
 }
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
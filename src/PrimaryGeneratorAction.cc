@@ -30,6 +30,12 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 #include "PrimaryGeneratorAction.hh"
 #include "InputReader.hh"
+#include "ResponseMatrix.hh"
+#include "EventScheduler.hh"
+#include "PerformanceReport.hh"
+#include "Telemetry.hh"
+#include "TraceRecorder.hh"
+#include "RunTallies.hh"
 
 #include "G4PrimaryParticle.hh"
 #include "G4PrimaryVertex.hh"
@@ -37,7 +43,6 @@
 #include "G4Event.hh"
 
 #include "G4ParticleDefinition.hh"
-#include "G4ParticleTable.hh"
 
 #include "G4ParticleGun.hh"
 
@@ -46,17 +51,23 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 /**
-\brief Retrieve the G4ParticleTable instance.
+\brief Store the pointers to the shared instances.
 
 */
-PrimaryGeneratorAction::PrimaryGeneratorAction(InputReader* inputReader)
+PrimaryGeneratorAction::PrimaryGeneratorAction(InputReader* inputReader, ResponseMatrix* responseMatrix,
+                                               EventScheduler* eventScheduler,
+                                               PerformanceReport* performanceReport,
+                                               Telemetry* telemetry, TraceRecorder* traceRecorder,
+                                               RunTallies* runTallies)
 : G4VUserPrimaryGeneratorAction(),
-  fParticleTable(nullptr),
-  fInputReader(inputReader)
-{
-  // get particle table instance
-  fParticleTable = G4ParticleTable::GetParticleTable();
-}
+  fInputReader(inputReader),
+  fResponseMatrix(responseMatrix),
+  fEventScheduler(eventScheduler),
+  fPerformanceReport(performanceReport),
+  fTelemetry(telemetry),
+  fTraceRecorder(traceRecorder),
+  fRunTallies(runTallies)
+{}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -72,40 +83,79 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
 /**
 \brief Generate primary particles.
 
-The primary particle is defined with properties of a random input macro-particle.
+The primary particles are read from the input file, or generated by the
+response matrix in build mode. The generation is timed for the performance
+report and the trace, and the previous event, complete at this point, is
+counted for the live status file. With an event seed, the engine is first
+reseeded from the global event index.
 
 This virtual function is called at the begining of each event.
 */
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-  // get particle definition
-  G4ParticleDefinition* particleDefinition
-    = fParticleTable->FindParticle(fInputReader->GetParticleName());
-
-  // create a primary particle
-  G4PrimaryParticle* particle = new G4PrimaryParticle(particleDefinition);
-
-  // pick a random macro-particle
-  G4int id = std::floor(G4UniformRand() * fInputReader->GetNumberOfMacroParticles());
-
-  // set macro-particle statistical weight
-  G4double w = fInputReader->GetMacroParticleWeight(id);
-  particle->SetWeight(w);
-
-  // set macro-particle momentum
-  G4ThreeVector p = fInputReader->GetMacroParticleMomentum(id);
-  particle->SetMomentum(p[0],p[1],p[2]);
+  fEventScheduler->SeedEvent(anEvent->GetEventID());
+  fTelemetry->ScoreEvent(*fRunTallies);
+  fTraceRecorder->ScoreEvent(anEvent->GetEventID());
+  TraceRecorder::Clock::time_point start = fTraceRecorder->Start();
+  fPerformanceReport->BeginGeneration();
+
+  // sample the response matrix bins instead of the input file
+  if (fResponseMatrix->IsBuilding())
+  {
+    fResponseMatrix->GeneratePrimaries(anEvent);
+  }
+  else
+  {
+    GenerateInputPrimaries(anEvent);
+  }
+
+  fPerformanceReport->EndGeneration();
+  fTraceRecorder->AddSpan("generation", start);
+}
 
-  // get macro-particle position and time
-  G4ThreeVector r = fInputReader->GetMacroParticlePosition(id);
-  G4double t = fInputReader->GetMacroParticleTime(id);
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  // set macro-particle position and time
-  G4PrimaryVertex* vertex = new G4PrimaryVertex(r,t);
-  vertex->SetPrimary(particle);
+/**
+\brief Generate primary particles from the input macro-particles.
 
-  // generate the event
-  anEvent->AddPrimaryVertex(vertex);
+Each primary particle is defined with properties of an input macro-particle,
+chosen by the event scheduler. Several primaries can be generated in each event
+to amortize the event overhead.
+*/
+void PrimaryGeneratorAction::GenerateInputPrimaries(G4Event* anEvent)
+{
+  // get cached particle definition
+  G4ParticleDefinition* particleDefinition = fInputReader->GetParticleDefinition();
+
+  // pick the macro-particles of the event
+  fMacroParticleIds.resize(fInputReader->GetPrimariesPerEvent());
+  fEventScheduler->NextMacroParticles(fInputReader->GetNumberOfMacroParticles(), fMacroParticleIds);
+
+  for (G4int id : fMacroParticleIds)
+  {
+    // create a primary particle
+    G4PrimaryParticle* particle = new G4PrimaryParticle(particleDefinition);
+
+    // set macro-particle statistical weight
+    G4double w = fInputReader->GetMacroParticleWeight(id);
+    particle->SetWeight(w);
+    fRunTallies->ScorePrimary(w);
+
+    // set macro-particle momentum
+    G4ThreeVector p = fInputReader->GetMacroParticleMomentum(id);
+    particle->SetMomentum(p[0],p[1],p[2]);
+
+    // get macro-particle position and time
+    G4ThreeVector r = fInputReader->GetMacroParticlePosition(id);
+    G4double t = fInputReader->GetMacroParticleTime(id);
+
+    // set macro-particle position and time
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(r,t);
+    vertex->SetPrimary(particle);
+
+    // generate the event
+    anEvent->AddPrimaryVertex(vertex);
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,678 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ResponseMatrix.cc
+/// \brief Implementation of the ResponseMatrix class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "ResponseMatrix.hh"
+#include "Units.hh"
+#include "DetectorConstruction.hh"
+#include "PhysicsList.hh"
+#include "InputReader.hh"
+#include "Hash.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4ParticleTable.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4Positron.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+namespace { G4Mutex mergeMutex = G4MUTEX_INITIALIZER; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set default binning and call SetCommands.
+
+*/
+ResponseMatrix::ResponseMatrix(Units* units, DetectorConstruction* detector)
+: fMessenger(nullptr),
+  fUnits(units),
+  fDetector(detector),
+  fBuilding(false),
+  fNumberOfEnergyBins(40),
+  fEnergyMin(1.*keV),
+  fEnergyMax(1.*GeV),
+  fNumberOfAngleBins(9),
+  fCacheDirectory("."),
+  fFoldFileName("folded_response.txt")
+{
+  fSpecies[0] = G4Electron::Electron();
+  fSpecies[1] = G4Gamma::Gamma();
+  fSpecies[2] = G4Positron::Positron();
+
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+ResponseMatrix::~ResponseMatrix()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Generate a primary particle in a random incoming bin.
+
+The energy is sampled uniformly in log and the direction isotropically inside
+the bin, and the particle is sent to the center of the target front face.
+
+This method replaces the input file sampling in build mode.
+*/
+void ResponseMatrix::GeneratePrimaries(G4Event* anEvent)
+{
+  Tallies& tallies = fThreadTallies.Get();
+  if (tallies.numberOfPrimaries.empty()) tallies.numberOfPrimaries.resize(GetNumberOfIncomingBins(), 0.);
+
+  // pick a random incoming bin
+  G4int bin = std::min((G4int)(G4UniformRand() * GetNumberOfIncomingBins()), GetNumberOfIncomingBins() - 1);
+  G4int species   = bin / (fNumberOfEnergyBins * fNumberOfAngleBins);
+  G4int energyBin = (bin / fNumberOfAngleBins) % fNumberOfEnergyBins;
+  G4int angleBin  = bin % fNumberOfAngleBins;
+
+  tallies.incomingBin = bin;
+  tallies.numberOfPrimaries[bin]++;
+
+  // sample energy and direction inside the bin
+  G4double logEnergyStep = std::log(fEnergyMax/fEnergyMin) / fNumberOfEnergyBins;
+  G4double energy = fEnergyMin * std::exp((energyBin + G4UniformRand()) * logEnergyStep);
+
+  G4double angleStep = halfpi / fNumberOfAngleBins;
+  G4double cosThetaMax = std::cos(angleBin * angleStep);
+  G4double cosThetaMin = std::cos((angleBin + 1) * angleStep);
+  G4double cosTheta = cosThetaMin + G4UniformRand() * (cosThetaMax - cosThetaMin);
+  G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+  G4double phi = twopi * G4UniformRand();
+
+  // create the primary particle
+  G4PrimaryParticle* particle = new G4PrimaryParticle(fSpecies[species]);
+  particle->SetKineticEnergy(energy);
+  particle->SetMomentumDirection(G4ThreeVector(cosTheta, sinTheta*std::cos(phi), sinTheta*std::sin(phi)));
+
+  // set the vertex just before the target front face
+  G4PrimaryVertex* vertex = new G4PrimaryVertex(G4ThreeVector(-1.*um, 0., 0.), 0.);
+  vertex->SetPrimary(particle);
+  anEvent->AddPrimaryVertex(vertex);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Score the particles leaving the target.
+
+The exit face is the front face (0), the rear face (1) or the side (2).
+*/
+void ResponseMatrix::ScoreExit(const G4Step* aStep)
+{
+  G4StepPoint* postStepPoint = aStep->GetPostStepPoint();
+  if (postStepPoint->GetStepStatus() != fGeomBoundary) return;
+
+  // keep only the steps from a layer to the world
+  const G4VPhysicalVolume* preVolume  = aStep->GetPreStepPoint()->GetPhysicalVolume();
+  const G4VPhysicalVolume* postVolume = postStepPoint->GetPhysicalVolume();
+  if (!DetectorConstruction::IsTargetVolume(preVolume) || DetectorConstruction::IsTargetVolume(postVolume)) return;
+
+  Tallies& tallies = fThreadTallies.Get();
+  G4int species = GetSpeciesIndex(aStep->GetTrack()->GetDefinition());
+  if (tallies.incomingBin < 0 || species < 0) return;
+
+  G4int energyBin = GetEnergyBin(postStepPoint->GetKineticEnergy());
+  if (energyBin < 0) return;
+
+  G4double cosTheta = std::max(-1., std::min(1., postStepPoint->GetMomentumDirection().x()));
+  G4int angleBin = GetAngleBin(std::acos(cosTheta), 2 * fNumberOfAngleBins, pi);
+
+  G4double x = postStepPoint->GetPosition().x();
+  G4int face = 2;
+  if (x <= 1.*nm) face = 0;
+  else if (x >= fDetector->GetTargetSizeLongi() - 1.*nm) face = 1;
+
+  G4int outgoingBin = ((face * 3 + species) * fNumberOfEnergyBins + energyBin) * 2 * fNumberOfAngleBins + angleBin;
+  tallies.weights[(G4long)tallies.incomingBin * GetNumberOfOutgoingBins() + outgoingBin] += postStepPoint->GetWeight();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the merged tallies, starting from the cached matrix if it exists.
+
+Successive builds of the same configuration are thus accumulated in the cache.
+
+This method is called by the master at the beginning of each run.
+*/
+void ResponseMatrix::BeginOfRun()
+{
+  if (!fBuilding) return;
+
+  fMergedTallies = Tallies();
+  if (ReadCacheFile())
+  {
+    G4cout << "Response matrix : adding statistics to " << GetCacheFileName() << G4endl;
+  }
+  else
+  {
+    G4cout << "Response matrix : building " << GetCacheFileName() << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the tallies of the current thread to the merged tallies.
+
+This method is called by each worker at the end of the run.
+*/
+void ResponseMatrix::MergeThreadTallies()
+{
+  if (!fBuilding) return;
+
+  Tallies& tallies = fThreadTallies.Get();
+
+  G4AutoLock lock(&mergeMutex);
+  if (fMergedTallies.numberOfPrimaries.empty())
+  {
+    fMergedTallies.numberOfPrimaries.resize(GetNumberOfIncomingBins(), 0.);
+  }
+  for (size_t bin=0; bin<tallies.numberOfPrimaries.size(); bin++)
+  {
+    fMergedTallies.numberOfPrimaries[bin] += tallies.numberOfPrimaries[bin];
+  }
+  for (const auto& it : tallies.weights)
+  {
+    fMergedTallies.weights[it.first] += it.second;
+  }
+  lock.unlock();
+
+  // reset thread tallies for the next run
+  tallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the response matrix in the cache file.
+
+The file format is :
+numberOfEnergyBins  energyMin(MeV)  energyMax(MeV)  numberOfAngleBins
+incomingBin  numberOfPrimaries     (for all incoming bins)
+incomingBin  outgoingBin  weight   (for non empty bins)
+
+with lines starting with # being ignored.
+
+This method is called by the master at the end of each run.
+*/
+void ResponseMatrix::EndOfRun()
+{
+  if (!fBuilding) return;
+
+  std::ofstream output(GetCacheFileName());
+  if (!output)
+  {
+    G4cerr << "Can not write response matrix in " << GetCacheFileName() << G4endl;
+    return;
+  }
+
+  output << std::setprecision(12);
+  output << "# Response matrix generated by gp3m2" << G4endl;
+  output << "# configuration : " << GetConfiguration() << G4endl;
+  output << "# numberOfEnergyBins  energyMin (MeV)  energyMax (MeV)  numberOfAngleBins" << G4endl;
+  output << fNumberOfEnergyBins << " " << fEnergyMin/MeV << " " << fEnergyMax/MeV << " " << fNumberOfAngleBins << G4endl;
+
+  output << "# incomingBin  numberOfPrimaries" << G4endl;
+  fMergedTallies.numberOfPrimaries.resize(GetNumberOfIncomingBins(), 0.);
+  for (G4int bin=0; bin<GetNumberOfIncomingBins(); bin++)
+  {
+    output << bin << " " << fMergedTallies.numberOfPrimaries[bin] << G4endl;
+  }
+
+  output << "# incomingBin  outgoingBin  weight" << G4endl;
+  for (const auto& it : fMergedTallies.weights)
+  {
+    output << it.first / GetNumberOfOutgoingBins() << " " << it.first % GetNumberOfOutgoingBins() << " " << it.second << G4endl;
+  }
+  output.close();
+
+  G4cout << "Response matrix written in " << GetCacheFileName() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Fold an input phase space through the cached response matrix.
+
+Each macro-particle contributes its weight times the mean response of its
+incoming bin, so that the folded weights are in the same unit as the output
+weights of a full simulation. The result is written in fFoldFileName, with
+one line per non empty (face, particle, energy, angle) bin.
+
+Macro-particles outside the matrix bins, or in bins without statistics, are
+not folded and their total weight is reported.
+*/
+void ResponseMatrix::Fold(G4String inputFileName, G4String particleName)
+{
+  G4int species = GetSpeciesIndex(G4ParticleTable::GetParticleTable()->FindParticle(particleName));
+  if (species < 0)
+  {
+    G4cerr << "Response matrix is only available for e-, gamma and e+ : " << particleName << G4endl;
+    return;
+  }
+
+  // load the matrix of the current configuration
+  fMergedTallies = Tallies();
+  if (!ReadCacheFile())
+  {
+    G4cerr << "No response matrix for the current configuration : " << GetCacheFileName() << G4endl;
+    return;
+  }
+
+  // read the phase space
+  InputReader inputReader(fUnits);
+  inputReader.SetInputFileName(inputFileName);
+  inputReader.SetParticleName(particleName);
+  inputReader.ReadInputFile();
+
+  // sum the input weights per incoming bin
+  G4double mass = fSpecies[species]->GetPDGMass();
+  std::vector<G4double> inputWeights(GetNumberOfIncomingBins(), 0.);
+  G4double totalWeight = 0., outsideWeight = 0., missingWeight = 0.;
+
+  for (G4int id=0; id<inputReader.GetNumberOfMacroParticles(); id++)
+  {
+    G4double w = inputReader.GetMacroParticleWeight(id);
+    G4ThreeVector p = inputReader.GetMacroParticleMomentum(id);
+    totalWeight += w;
+
+    G4double energy = std::sqrt(p.mag2() + mass*mass) - mass;
+    G4int energyBin = GetEnergyBin(energy);
+    G4int angleBin  = (p.mag() > 0.) ? GetAngleBin(p.angle(G4ThreeVector(1.,0.,0.)), fNumberOfAngleBins, halfpi) : -1;
+    if (energyBin < 0 || angleBin < 0)
+    {
+      outsideWeight += w;
+      continue;
+    }
+
+    G4int bin = (species * fNumberOfEnergyBins + energyBin) * fNumberOfAngleBins + angleBin;
+    if (fMergedTallies.numberOfPrimaries[bin] > 0.)
+    {
+      inputWeights[bin] += w;
+    }
+    else
+    {
+      missingWeight += w;
+    }
+  }
+
+  // fold the input weights with the mean response of each bin
+  std::vector<G4double> folded(GetNumberOfOutgoingBins(), 0.);
+  for (const auto& it : fMergedTallies.weights)
+  {
+    G4int incomingBin = it.first / GetNumberOfOutgoingBins();
+    if (inputWeights[incomingBin] == 0.) continue;
+    folded[it.first % GetNumberOfOutgoingBins()]
+      += inputWeights[incomingBin] * it.second / fMergedTallies.numberOfPrimaries[incomingBin];
+  }
+
+  // write the folded spectra
+  std::ofstream output(fFoldFileName);
+  const G4String faceNames[3] = {"front", "rear", "side"};
+  G4double logEnergyStep = std::log(fEnergyMax/fEnergyMin) / fNumberOfEnergyBins;
+  G4double angleStep = pi / (2 * fNumberOfAngleBins);
+
+  output << "# Response of " << inputFileName << " folded by gp3m2" << G4endl;
+  output << "# face  particle  energyMin (MeV)  energyMax (MeV)  thetaMin (deg)  thetaMax (deg)  weight" << G4endl;
+  for (G4int bin=0; bin<GetNumberOfOutgoingBins(); bin++)
+  {
+    if (folded[bin] == 0.) continue;
+    G4int angleBin  = bin % (2 * fNumberOfAngleBins);
+    G4int energyBin = (bin / (2 * fNumberOfAngleBins)) % fNumberOfEnergyBins;
+    G4int outgoing  = bin / (2 * fNumberOfAngleBins * fNumberOfEnergyBins);
+    output << faceNames[outgoing / 3] << " " << fSpecies[outgoing % 3]->GetParticleName() << " "
+           << fEnergyMin * std::exp(energyBin * logEnergyStep)/MeV << " "
+           << fEnergyMin * std::exp((energyBin + 1) * logEnergyStep)/MeV << " "
+           << angleBin * angleStep/deg << " " << (angleBin + 1) * angleStep/deg << " "
+           << folded[bin] << G4endl;
+  }
+  output.close();
+
+  G4cout << "Response matrix folded in " << fFoldFileName << G4endl
+         << " Input weight                        : " << totalWeight << G4endl
+         << " Weight outside the matrix bins      : " << outsideWeight << G4endl
+         << " Weight in bins without statistics   : " << missingWeight << G4endl;
+
+  // release the matrix, so that the binning can be changed
+  fMergedTallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return a description of the target, physics and binning settings.
+
+*/
+G4String ResponseMatrix::GetConfiguration() const
+{
+  std::ostringstream configuration;
+  configuration.precision(12);
+  configuration << fDetector->GetConfiguration();
+
+  const PhysicsList* physicsList
+    = dynamic_cast<const PhysicsList*>(G4RunManager::GetRunManager()->GetUserPhysicsList());
+  if (physicsList) configuration << " ; " << physicsList->GetConfiguration();
+
+  configuration << " ; bins " << fNumberOfEnergyBins << " " << fEnergyMin/MeV << " "
+                << fEnergyMax/MeV << " " << fNumberOfAngleBins;
+
+  return configuration.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the cache file name of the current configuration.
+
+*/
+G4String ResponseMatrix::GetCacheFileName() const
+{
+  return fCacheDirectory + "/response_" + FormatHash(ComputeHash(GetConfiguration())) + ".txt";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Read the cache file of the current configuration in the merged tallies.
+
+Return false if the file does not exist or does not match the current binning.
+*/
+G4bool ResponseMatrix::ReadCacheFile()
+{
+  std::ifstream input(GetCacheFileName());
+  if (!input) return false;
+
+  Tallies tallies;
+  tallies.numberOfPrimaries.resize(GetNumberOfIncomingBins(), 0.);
+
+  std::string str;
+  G4bool headerRead = false;
+  G4int numberOfPrimaryLines = 0;
+  while (std::getline(input, str))
+  {
+    if (str.empty() || str[0] == '#') continue;
+    std::stringstream ss(str);
+
+    if (!headerRead)
+    {
+      G4int numberOfEnergyBins, numberOfAngleBins;
+      G4double energyMin, energyMax;
+      ss >> numberOfEnergyBins >> energyMin >> energyMax >> numberOfAngleBins;
+      if (numberOfEnergyBins != fNumberOfEnergyBins || numberOfAngleBins != fNumberOfAngleBins
+          || std::abs(energyMin*MeV - fEnergyMin) > 1e-9*fEnergyMin
+          || std::abs(energyMax*MeV - fEnergyMax) > 1e-9*fEnergyMax)
+      {
+        G4cerr << "Response matrix binning does not match in " << GetCacheFileName() << G4endl;
+        return false;
+      }
+      headerRead = true;
+    }
+    else if (numberOfPrimaryLines < GetNumberOfIncomingBins())
+    {
+      G4int bin;
+      ss >> bin >> tallies.numberOfPrimaries[numberOfPrimaryLines];
+      numberOfPrimaryLines++;
+    }
+    else
+    {
+      G4long incomingBin, outgoingBin;
+      G4double weight;
+      ss >> incomingBin >> outgoingBin >> weight;
+      if (incomingBin < 0 || incomingBin >= GetNumberOfIncomingBins()
+          || outgoingBin < 0 || outgoingBin >= GetNumberOfOutgoingBins())
+      {
+        G4cerr << "Response matrix bin out of range in " << GetCacheFileName() << G4endl;
+        return false;
+      }
+      tallies.weights[incomingBin * GetNumberOfOutgoingBins() + outgoingBin] = weight;
+    }
+  }
+  input.close();
+
+  fMergedTallies = tallies;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the index of e-, gamma and e+, or -1 for other particles.
+
+*/
+G4int ResponseMatrix::GetSpeciesIndex(const G4ParticleDefinition* particle) const
+{
+  for (G4int species=0; species<3; species++)
+  {
+    if (particle == fSpecies[species]) return species;
+  }
+  return -1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the logarithmic energy bin, or -1 outside [fEnergyMin,fEnergyMax[.
+
+*/
+G4int ResponseMatrix::GetEnergyBin(G4double energy) const
+{
+  if (energy < fEnergyMin || energy >= fEnergyMax) return -1;
+  G4int bin = (G4int)(fNumberOfEnergyBins * std::log(energy/fEnergyMin) / std::log(fEnergyMax/fEnergyMin));
+  return std::min(bin, fNumberOfEnergyBins - 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the angle bin in [0,thetaMax], or -1 if above thetaMax.
+
+*/
+G4int ResponseMatrix::GetAngleBin(G4double theta, G4int numberOfAngleBins, G4double thetaMax) const
+{
+  if (theta > thetaMax) return -1;
+  return std::min((G4int)(numberOfAngleBins * theta / thetaMax), numberOfAngleBins - 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if the binning can not be changed, a matrix being built.
+
+In build mode, the matrix of the current binning is accumulated over the runs.
+*/
+G4bool ResponseMatrix::IsBinningLocked() const
+{
+  if (fBuilding)
+  {
+    G4cerr << "Response matrix is being built, disable the build mode before changing the binning" << G4endl;
+  }
+  return fBuilding;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the number of logarithmic energy bins.
+
+*/
+void ResponseMatrix::SetNumberOfEnergyBins(G4int numberOfEnergyBins)
+{
+  if (IsBinningLocked()) return;
+  fNumberOfEnergyBins = numberOfEnergyBins;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the lower edge of the energy bins.
+
+*/
+void ResponseMatrix::SetEnergyMin(G4double energyMin)
+{
+  if (IsBinningLocked()) return;
+  if (energyMin <= 0. || energyMin >= fEnergyMax)
+  {
+    G4cerr << "Invalid response matrix energy min : " << energyMin/MeV << " MeV" << G4endl;
+    return;
+  }
+  fEnergyMin = energyMin;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the upper edge of the energy bins.
+
+*/
+void ResponseMatrix::SetEnergyMax(G4double energyMax)
+{
+  if (IsBinningLocked()) return;
+  if (energyMax <= fEnergyMin)
+  {
+    G4cerr << "Invalid response matrix energy max : " << energyMax/MeV << " MeV" << G4endl;
+    return;
+  }
+  fEnergyMax = energyMax;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the number of incoming angle bins in [0,90] deg.
+
+*/
+void ResponseMatrix::SetNumberOfAngleBins(G4int numberOfAngleBins)
+{
+  if (IsBinningLocked()) return;
+  fNumberOfAngleBins = numberOfAngleBins;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/response/setBuildMode true|false
+/response/setEnergyBins number
+/response/setEnergyMin value unit
+/response/setEnergyMax value unit
+/response/setAngleBins number
+/response/setCacheDirectory directory
+/response/setFoldFileName fileName
+/response/fold inputFileName particleName
+*/
+void ResponseMatrix::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/response/","Manage target response matrix");
+
+  // define commands
+  G4GenericMessenger::Command& setBuildModeCmd
+    = fMessenger->DeclareProperty("setBuildMode",
+                                fBuilding,
+                                "Build the response matrix of the target during the next runs");
+
+  G4GenericMessenger::Command& setEnergyBinsCmd
+    = fMessenger->DeclareMethod("setEnergyBins",
+                                &ResponseMatrix::SetNumberOfEnergyBins,
+                                "Set the number of logarithmic energy bins");
+
+  G4GenericMessenger::Command& setEnergyMinCmd
+    = fMessenger->DeclareMethodWithUnit("setEnergyMin",
+                                "MeV",
+                                &ResponseMatrix::SetEnergyMin,
+                                "Set the lower edge of the energy bins");
+
+  G4GenericMessenger::Command& setEnergyMaxCmd
+    = fMessenger->DeclareMethodWithUnit("setEnergyMax",
+                                "MeV",
+                                &ResponseMatrix::SetEnergyMax,
+                                "Set the upper edge of the energy bins");
+
+  G4GenericMessenger::Command& setAngleBinsCmd
+    = fMessenger->DeclareMethod("setAngleBins",
+                                &ResponseMatrix::SetNumberOfAngleBins,
+                                "Set the number of incoming angle bins in [0,90] deg");
+
+  G4GenericMessenger::Command& setCacheDirectoryCmd
+    = fMessenger->DeclareProperty("setCacheDirectory",
+                                fCacheDirectory,
+                                "Set the directory of the response matrix files");
+
+  G4GenericMessenger::Command& setFoldFileNameCmd
+    = fMessenger->DeclareProperty("setFoldFileName",
+                                fFoldFileName,
+                                "Set the output file of the folded spectra");
+
+  G4GenericMessenger::Command& foldCmd
+    = fMessenger->DeclareMethod("fold",
+                                &ResponseMatrix::Fold,
+                                "Fold an input file through the cached response matrix");
+
+  // set commands properties
+  setBuildModeCmd.SetStates(G4State_Idle);
+  setEnergyBinsCmd.SetStates(G4State_Idle);
+  setEnergyMinCmd.SetStates(G4State_Idle);
+  setEnergyMaxCmd.SetStates(G4State_Idle);
+  setAngleBinsCmd.SetStates(G4State_Idle);
+  setCacheDirectoryCmd.SetStates(G4State_Idle);
+  setFoldFileNameCmd.SetStates(G4State_Idle);
+  foldCmd.SetStates(G4State_Idle);
+  foldCmd.SetToBeBroadcasted(false);
+
+  setEnergyBinsCmd.SetParameterName("bins", false);
+  setEnergyBinsCmd.SetRange("bins>0");
+  setAngleBinsCmd.SetParameterName("bins", false);
+  setAngleBinsCmd.SetRange("bins>0");
+}
@@ -32,23 +32,64 @@
 #include "RunAction.hh"
 
 #include "G4RunManager.hh" // includes all the needed classes for RunAction
+#include "G4MTRunManager.hh"
 #include "G4Run.hh"
+#include "Randomize.hh"
 
 #include "Units.hh"
+#include "DetectorConstruction.hh"
 #include "InputReader.hh"
 #include "Diagnostics.hh"
+#include "WeightWindows.hh"
+#include "ResponseMatrix.hh"
+#include "EventScheduler.hh"
+#include "Checkpoint.hh"
+#include "AdaptiveStopping.hh"
+#include "PerformanceReport.hh"
+#include "Telemetry.hh"
+#include "TraceRecorder.hh"
+#include "ThreadPlacement.hh"
+#include "Hash.hh"
+
+#include "G4AccumulableManager.hh"
+
+#include <sstream>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 /**
-\brief .
+\brief Register the run tallies and call SetCommands.
 
 */
-RunAction::RunAction(Units* units, InputReader* inputReader, Diagnostics* diagnostics)
+RunAction::RunAction(Units* units, DetectorConstruction* detector, InputReader* inputReader, Diagnostics* diagnostics,
+                     WeightWindows* weightWindows, ResponseMatrix* responseMatrix,
+                     EventScheduler* eventScheduler, Checkpoint* checkpoint,
+                     AdaptiveStopping* adaptiveStopping, PerformanceReport* performanceReport,
+                     Telemetry* telemetry, TraceRecorder* traceRecorder, ThreadPlacement* threadPlacement)
 : G4UserRunAction(),
+  fMessenger(nullptr),
   fUnits(units),
+  fDetector(detector),
   fInputReader(inputReader),
-  fDiagnostics(diagnostics)
-{}
+  fDiagnostics(diagnostics),
+  fWeightWindows(weightWindows),
+  fResponseMatrix(responseMatrix),
+  fEventScheduler(eventScheduler),
+  fCheckpoint(checkpoint),
+  fAdaptiveStopping(adaptiveStopping),
+  fPerformanceReport(performanceReport),
+  fTelemetry(telemetry),
+  fTraceRecorder(traceRecorder),
+  fThreadPlacement(threadPlacement),
+  fShardIndex(0),
+  fNumberOfShards(1),
+  fSummaryFileName("summary.txt")
+{
+  // register the run tallies, merged by the master at the end of the run
+  G4AccumulableManager::Instance()->RegisterAccumulable(&fRunTallies);
+
+  SetCommands();
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -60,6 +101,7 @@ RunAction::~RunAction()
 {
   delete fInputReader;
   delete fDiagnostics;
+  delete fMessenger;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -67,16 +109,58 @@ RunAction::~RunAction()
 /**
 \brief Read input file & initialize diagnostics.
 
-This user code is executed at the beginning of each run
+This user code is executed at the beginning of each run. With the serial run
+manager, the master instance also processes the events. During a segmented
+run, the weights are normalized by the total number of events of the segments.
+The number of events is always the one of the master run, whatever the number
+of events processed by each thread.
 */
 void RunAction::BeginOfRunAction(const G4Run* aRun)
 {
-  // read input file
-  fInputReader->ReadInputFile();
-  fInputReader->NormalizeMacroParticlesWeights(aRun->GetNumberOfEventToBeProcessed());
+  G4int numberOfEvents = aRun->GetNumberOfEventToBeProcessed();
+
+  // reset the run tallies of this thread
+  G4AccumulableManager::Instance()->Reset();
 
-  // Initialize diagnostics
+  // prepare shared data before the workers start
+  if (IsMaster())
+  {
+    fCheckpoint->BeginOfRun(numberOfEvents);
+    fWeightWindows->BeginOfRun(fCheckpoint->GetNormalizationEvents());
+    fResponseMatrix->BeginOfRun();
+    fEventScheduler->BeginOfRun(fCheckpoint->IsActive() ? 0 : aRun->GetRunID(), fCheckpoint->GetFirstEventIndex());
+    fPerformanceReport->BeginOfRun();
+    fTelemetry->BeginOfRun(aRun->GetRunID(), numberOfEvents, fCheckpoint->IsActive() ? fCheckpoint->GetSegmentIndex() : -1);
+    fTraceRecorder->BeginOfRun();
+    fThreadPlacement->BeginOfRun();
+    if (fNumberOfShards > 1) SetShardSeeds();
+    fRunTimer.Start();
+  }
+
+  // nothing else to do without events to process
+  if (!fInputReader) return;
+
+  // the worker is already pinned, so that the input is allocated on its NUMA node
+  fThreadPlacement->RecordThread();
+
+  // attach the fast simulation models of the regions given since the last run
+  fDetector->AttachFastSimulationModels();
+
+  // read input file, unless primaries are generated by the response matrix
+  TraceRecorder::Clock::time_point start = fTraceRecorder->Start();
+  if (!fResponseMatrix->IsBuilding())
+  {
+    fInputReader->ReadInputFile();
+    fInputReader->NormalizeMacroParticlesWeights(fCheckpoint->GetNormalizationEvents());
+    fEventScheduler->PrepareRun(fInputReader, numberOfEvents * fInputReader->GetPrimariesPerEvent());
+  }
+  fTraceRecorder->AddSpan("input load", start);
+
+  // Initialize diagnostics, in the files of the segment
+  start = fTraceRecorder->Start();
+  fDiagnostics->SetSegment(fCheckpoint->IsActive() ? fCheckpoint->GetSegmentIndex() : -1);
   fDiagnostics->InitializeAllDiags();
+  fTraceRecorder->AddSpan("file open", start);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -86,10 +170,138 @@ void RunAction::BeginOfRunAction(const G4Run* aRun)
 
 This user code is executed at the end of each run
 */
-void RunAction::EndOfRunAction(const G4Run* /*run*/)
+void RunAction::EndOfRunAction(const G4Run* aRun)
+{
+  if (fInputReader)
+  {
+    // merge thread tallies
+    TraceRecorder::Clock::time_point start = fTraceRecorder->Start();
+    fWeightWindows->MergeThreadTallies();
+    fResponseMatrix->MergeThreadTallies();
+    fEventScheduler->MergeThreadTallies();
+    fPerformanceReport->MergeThreadTallies();
+    fAdaptiveStopping->AddThreadBatch(fRunTallies);
+    fTelemetry->MergeThreadTallies(fRunTallies);
+    fDetector->MergeFastSimulationCounts();
+
+    // add the run tallies of this worker to the master ones (nothing done on the master)
+    G4AccumulableManager::Instance()->Merge();
+    fTraceRecorder->AddSpan("merge", start);
+
+    // save diagnostics
+    start = fTraceRecorder->Start();
+    fDiagnostics->FinishAllDiags();
+    fTraceRecorder->AddSpan("file write", start);
+    fTraceRecorder->MergeThreadTallies();
+  }
+
+  // report merged results, once all the workers are done
+  if (IsMaster())
+  {
+    fWeightWindows->EndOfRun(fCheckpoint->GetNormalizationEvents());
+    fResponseMatrix->EndOfRun();
+    fRunTimer.Stop();
+    fEventScheduler->EndOfRun(fRunTimer.GetRealElapsed());
+    fPerformanceReport->EndOfRun(fRunTimer.GetRealElapsed());
+    fTelemetry->EndOfRun();
+    fDetector->PrintFastSimulationCounts();
+
+    // the run tallies of the workers are already merged
+    fRunTallies.Print(aRun->GetNumberOfEvent());
+    if (fSummaryFileName != "") fRunTallies.Write(GetSummaryFileName(), aRun->GetNumberOfEvent());
+    PrintScalingReport(aRun);
+    fThreadPlacement->EndOfRun();
+    fTraceRecorder->EndOfRun();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reseed the master engine with seeds derived from the shard index.
+
+Two numbers are drawn from the engine, which is in the same state in all the
+shards, and hashed with the shard index. The seeds of each shard are thus
+independent, and reproducible for given macro seeds. The worker seeds are then
+generated by the master from these seeds.
+*/
+void RunAction::SetShardSeeds()
+{
+  std::ostringstream key;
+  key << (G4long)(G4UniformRand()*2147483647.) << " "
+      << (G4long)(G4UniformRand()*2147483647.) << " "
+      << fShardIndex << "/" << fNumberOfShards;
+  uint64_t hash = ComputeHash(key.str());
+
+  long seeds[3] = {(long)(hash & 0x7fffffff), (long)((hash >> 32) & 0x7fffffff), 0};
+  G4Random::setTheSeeds(seeds);
+
+  G4cout << "Shard " << fShardIndex << "/" << fNumberOfShards
+         << " : seeds " << seeds[0] << " " << seeds[1] << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the wall time and event rate of the run.
+
+The line is parsed by `benchmarks/scaling.py` to compute the speed-up and the
+parallel efficiency for several numbers of threads.
+*/
+void RunAction::PrintScalingReport(const G4Run* aRun)
 {
-  // save diagnostics
-  fDiagnostics->FinishAllDiags();
+  G4MTRunManager* mtRunManager = G4MTRunManager::GetMasterRunManager();
+  G4int numberOfThreads = mtRunManager ? mtRunManager->GetNumberOfThreads() : 1;
+  G4int numberOfEvents = aRun->GetNumberOfEvent();
+  G4double wallTime = fRunTimer.GetRealElapsed();
+  G4double eventRate = wallTime>0 ? numberOfEvents/wallTime : 0.;
+
+  G4cout << "Run " << aRun->GetRunID() << " scaling : "
+         << numberOfEvents << " events ; "
+         << numberOfThreads << " threads ; "
+         << "wall time " << wallTime << " s ; "
+         << eventRate << " events/s ; "
+         << eventRate/numberOfThreads << " events/s/thread" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the summary file name, with the shard and segment indices before the extension.
+
+*/
+G4String RunAction::GetSummaryFileName() const
+{
+  G4String suffix = "";
+  if (fNumberOfShards > 1) suffix += "_shard" + std::to_string(fShardIndex);
+  if (fCheckpoint->IsActive()) suffix += "_seg" + std::to_string(fCheckpoint->GetSegmentIndex());
+
+  G4String fileName = fSummaryFileName;
+  size_t dot = fileName.rfind('.');
+  fileName.insert((dot == std::string::npos) ? fileName.size() : dot, suffix);
+  return fileName;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/summary/setFileName fileName
+*/
+void RunAction::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/summary/","Manage the run summary");
+
+  // define commands
+  G4GenericMessenger::Command& setFileNameCmd
+    = fMessenger->DeclareMethod("setFileName",
+                                &RunAction::SetSummaryFileName,
+                                "Set the run summary file (none for no file)");
+
+  // set commands properties
+  setFileNameCmd.SetStates(G4State_PreInit,G4State_Idle);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
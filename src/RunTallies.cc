@@ -0,0 +1,230 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file RunTallies.cc
+/// \brief Implementation of the RunTallies class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "RunTallies.hh"
+
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+#include <iomanip>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Initialize empty tallies.
+
+*/
+RunTallies::RunTallies()
+: G4VAccumulable("RunTallies"),
+  fNumberOfPrimaries(0),
+  fPrimaryWeight(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Do nothing.
+
+*/
+RunTallies::~RunTallies()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the tallies of a worker.
+
+This method is called by each worker with G4AccumulableManager::Merge, on the
+master tallies.
+*/
+void RunTallies::Merge(const G4VAccumulable& other)
+{
+  const RunTallies& tallies = static_cast<const RunTallies&>(other);
+
+  fNumberOfPrimaries += tallies.fNumberOfPrimaries;
+  fPrimaryWeight     += tallies.fPrimaryWeight;
+  for (const auto& it : tallies.fCells)
+  {
+    Cell& cell = fCells[it.first];
+    cell.particle      = it.second.particle;
+    cell.count        += it.second.count;
+    cell.weight       += it.second.weight;
+    cell.energyWeight += it.second.energyWeight;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the tallies at the beginning of a run.
+
+*/
+void RunTallies::Reset()
+{
+  fNumberOfPrimaries = 0;
+  fPrimaryWeight = 0.;
+  fCells.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a generated primary.
+
+*/
+void RunTallies::ScorePrimary(G4double weight)
+{
+  fNumberOfPrimaries++;
+  fPrimaryWeight += weight;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add a phase space row recorded at an interface.
+
+*/
+void RunTallies::ScoreRecord(G4int interfaceIndex, const G4ParticleDefinition* particle, G4double weight, G4double energy)
+{
+  Cell& cell = fCells[CellKey(interfaceIndex, particle->GetPDGEncoding())];
+  cell.particle = particle;
+  cell.count++;
+  cell.weight       += weight;
+  cell.energyWeight += weight * energy;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the recorded weight of a species at an interface.
+
+The particle name `all` sums the weights of all the species.
+*/
+G4double RunTallies::GetRecordedWeight(G4int interfaceIndex, const G4String& particleName) const
+{
+  G4double weight = 0.;
+  for (const auto& it : fCells)
+  {
+    if (it.first.first != interfaceIndex) continue;
+    if (particleName == "all" || it.second.particle->GetParticleName() == particleName)
+      weight += it.second.weight;
+  }
+  return weight;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the recorded weight of a species at all the interfaces.
+
+*/
+G4double RunTallies::GetRecordedWeight(const G4ParticleDefinition* particle) const
+{
+  G4double weight = 0.;
+  for (const auto& it : fCells)
+  {
+    if (it.first.second == particle->GetPDGEncoding()) weight += it.second.weight;
+  }
+  return weight;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the number of rows recorded at all the interfaces.
+
+*/
+G4long RunTallies::GetNumberOfRecords() const
+{
+  G4long count = 0;
+  for (const auto& it : fCells) count += it.second.count;
+  return count;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the merged tallies.
+
+*/
+void RunTallies::Print(G4int numberOfEvents) const
+{
+  G4cout << G4endl
+         << "--------------------Run summary-----------------------------------" << G4endl
+         << " Events                     : " << numberOfEvents << G4endl
+         << " Primaries                  : " << fNumberOfPrimaries << G4endl
+         << " Primary weight             : " << fPrimaryWeight << G4endl
+         << G4endl
+         << " interface species      count       weight  energy flux (MeV)" << G4endl;
+  for (const auto& it : fCells)
+  {
+    G4cout << std::setw(10) << it.first.first
+           << std::setw(8)  << it.second.particle->GetParticleName()
+           << std::setw(11) << it.second.count
+           << std::setw(13) << it.second.weight
+           << std::setw(19) << it.second.energyWeight/MeV << G4endl;
+  }
+  G4cout << "-----------------------------------------------------------------" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the merged tallies in a summary file.
+
+The file format is :
+numberOfEvents  numberOfPrimaries  primaryWeight
+interface  species  count  weight  energyFlux(MeV)
+...
+
+with lines starting with # being comments.
+*/
+void RunTallies::Write(const G4String& fileName, G4int numberOfEvents) const
+{
+  std::ofstream output(fileName);
+  output << "# Run summary written by gp3m2" << G4endl;
+  output << "# numberOfEvents  numberOfPrimaries  primaryWeight" << G4endl;
+  output << numberOfEvents << " " << fNumberOfPrimaries << " "
+         << std::setprecision(15) << fPrimaryWeight << G4endl;
+  output << "# interface  species  count  weight  energyFlux (MeV)" << G4endl;
+  for (const auto& it : fCells)
+  {
+    output << it.first.first << " " << it.second.particle->GetParticleName() << " "
+           << it.second.count << " " << it.second.weight << " "
+           << it.second.energyWeight/MeV << G4endl;
+  }
+  output.close();
+
+  G4cout << "Run summary written in " << fileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -33,17 +33,31 @@
 #include "SteppingAction.hh"
 #include "RunAction.hh"
 #include "Diagnostics.hh"
+#include "DetectorConstruction.hh"
+#include "WeightWindows.hh"
+#include "ResponseMatrix.hh"
+#include "PerformanceReport.hh"
+#include "RunTallies.hh"
 
 #include "G4SteppingManager.hh" // includes all the needed classes for SteppingAction
+#include "Randomize.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 /**
 \brief Save pointer to the current Diagnostics instance.
 
 */
-SteppingAction::SteppingAction(Diagnostics* diagnostics)
+SteppingAction::SteppingAction(DetectorConstruction* detector, Diagnostics* diagnostics,
+                               WeightWindows* weightWindows, ResponseMatrix* responseMatrix,
+                               PerformanceReport* performanceReport, RunTallies* runTallies)
 : G4UserSteppingAction(),
-  fDiagnostics(diagnostics)
+  fDetector(detector),
+  fWeightWindows(weightWindows),
+  fResponseMatrix(responseMatrix),
+  fPerformanceReport(performanceReport),
+  fDiagnostics(diagnostics),
+  fRunTallies(runTallies),
+  fVoxelBoundary(false)
 {}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -73,7 +87,215 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
   G4Track* aTrack = aStep->GetTrack();
   const G4ParticleDefinition* particle = aTrack->GetDynamicParticle()->GetDefinition();
 
-  // Fill diagnostics if they are activated
-  fDiagnostics->FillDiagSurfacePhaseSpace(particle, stepPoint);
+  // Count the step in the layer where it occured
+  G4int layer = GetLayerCopyNumber(stepPoint);
+  if (fPerformanceReport->IsEnabled())
+    fPerformanceReport->ScoreStep(layer, particle, aTrack->GetCurrentStepNumber() == 1);
+
+  // Boundaries between the voxels of a grid are not target interfaces
+  G4bool voxelBoundary = fVoxelBoundary && aTrack->GetCurrentStepNumber() > 1;
+  G4bool onBoundary = (aStep->GetPostStepPoint()->GetStepStatus() == fGeomBoundary);
+  fVoxelBoundary = onBoundary && IsVoxelBoundary(aStep);
+
+  // Fill diagnostics if they are activated, or the response matrix in build mode
+  if (fResponseMatrix->IsBuilding())
+  {
+    fResponseMatrix->ScoreExit(aStep);
+  }
+  else if (!voxelBoundary)
+  {
+    if (fDiagnostics->FillDiagSurfacePhaseSpace(particle, stepPoint)) ScoreRecord(layer, particle, stepPoint);
+  }
+
+  // Apply variance reduction when the particle reaches a layer interface, the
+  // weight window of the entered layer replacing the importance splitting
+  if (onBoundary && aTrack->GetTrackStatus() == fAlive
+      && !fWeightWindows->HasWeightWindow(GetLayerCopyNumber(aStep->GetPostStepPoint())))
+  {
+    ApplyImportanceBiasing(aStep);
+  }
+
+  // Apply weight windows when the particle enters a layer, or to the primaries in their source layer
+  if (aTrack->GetTrackStatus() == fAlive && (fWeightWindows->IsActive() || fWeightWindows->IsPilot()))
+  {
+    G4int layer = -1;
+    if (onBoundary && !fVoxelBoundary)
+    {
+      layer = GetLayerCopyNumber(aStep->GetPostStepPoint());
+    }
+    else if (aTrack->GetParentID() == 0 && aTrack->GetCurrentStepNumber() == 1)
+    {
+      layer = GetLayerCopyNumber(stepPoint);
+    }
+
+    if (layer >= 0) ApplyWeightWindow(aStep, layer);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the layer copy number of the step point volume, or -1 if not in a layer.
+
+The layers of a periodic stack are numbered from the copy number of the stack.
+*/
+G4int SteppingAction::GetLayerCopyNumber(const G4StepPoint* stepPoint) const
+{
+  G4VPhysicalVolume* volume = stepPoint->GetPhysicalVolume();
+  if (!DetectorConstruction::IsTargetVolume(volume)) return -1;
+
+  // A voxel grid is numbered as one layer
+  if (DetectorConstruction::IsVoxelVolume(volume))
+  {
+    return stepPoint->GetTouchable()->GetCopyNumber(1);
+  }
+
+  if (volume->IsReplicated())
+  {
+    const G4VTouchable* touchable = stepPoint->GetTouchable();
+    return touchable->GetCopyNumber(1) + touchable->GetReplicaNumber(0);
+  }
+  return volume->GetCopyNo();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if the step ends on a boundary between two voxels of the same grid.
+
+*/
+G4bool SteppingAction::IsVoxelBoundary(const G4Step* aStep) const
+{
+  const G4VPhysicalVolume* preVolume  = aStep->GetPreStepPoint()->GetPhysicalVolume();
+  const G4VPhysicalVolume* postVolume = aStep->GetPostStepPoint()->GetPhysicalVolume();
+
+  return DetectorConstruction::IsVoxelVolume(preVolume) && DetectorConstruction::IsVoxelVolume(postVolume)
+      && GetLayerCopyNumber(aStep->GetPreStepPoint()) == GetLayerCopyNumber(aStep->GetPostStepPoint());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Count a phase space row recorded at the interface with the given layer.
+
+*/
+void SteppingAction::ScoreRecord(G4int interfaceIndex, const G4ParticleDefinition* particle, const G4StepPoint* stepPoint)
+{
+  fPerformanceReport->ScoreRecord();
+  fRunTallies->ScoreRecord(interfaceIndex, particle, stepPoint->GetWeight(), stepPoint->GetKineticEnergy());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Split or kill the particle according to the importance of the layers.
+
+The particle is split when entering a more important layer, or played with
+Russian roulette when entering a less important one, so that the total weight
+is conserved on average. Interfaces with the world volume, and with layers
+having a weight window, are ignored.
+*/
+void SteppingAction::ApplyImportanceBiasing(const G4Step* aStep)
+{
+  // Retrieve the layers on both sides of the interface
+  G4int preLayer  = GetLayerCopyNumber(aStep->GetPreStepPoint());
+  G4int postLayer = GetLayerCopyNumber(aStep->GetPostStepPoint());
+  if (preLayer < 0 || postLayer < 0) return;
+
+  // Compute the importance ratio
+  G4double ratio = fDetector->GetLayerImportance(postLayer)
+                 / fDetector->GetLayerImportance(preLayer);
+  if (ratio == 1.) return;
+
+  G4Track* aTrack = aStep->GetTrack();
+  G4double w = aTrack->GetWeight();
+
+  if (ratio > 1.)
+  {
+    // Splitting, with a random number of copies when the ratio is not an integer
+    G4int numberOfCopies = (G4int)ratio;
+    if (G4UniformRand() < ratio - numberOfCopies) numberOfCopies++;
+    SplitTrack(aStep, numberOfCopies, w/ratio);
+  }
+  else
+  {
+    // Russian roulette
+    if (G4UniformRand() < ratio)
+    {
+      aTrack->SetWeight(w/ratio);
+      aStep->GetPostStepPoint()->SetWeight(w/ratio);
+    }
+    else
+    {
+      aTrack->SetTrackStatus(fStopAndKill);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Apply the weight window of the given layer to the particle at the end of the step.
+
+In pilot mode, the particle is also scored to generate the weight windows.
+*/
+void SteppingAction::ApplyWeightWindow(const G4Step* aStep, G4int layer)
+{
+  G4Track* aTrack = aStep->GetTrack();
+  G4double energy = aStep->GetPostStepPoint()->GetKineticEnergy();
+  G4double w = aTrack->GetWeight();
+
+  if (fWeightWindows->IsPilot()) fWeightWindows->ScorePilot(layer, energy, w);
+
+  G4int numberOfCopies = fWeightWindows->ApplyWeightWindow(layer, energy, w);
+  if (numberOfCopies == 0)
+  {
+    aTrack->SetTrackStatus(fStopAndKill);
+  }
+  else if (numberOfCopies > 1)
+  {
+    SplitTrack(aStep, numberOfCopies, w);
+  }
+  else if (w != aTrack->GetWeight())
+  {
+    aTrack->SetWeight(w);
+    aStep->GetPostStepPoint()->SetWeight(w);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Split the current particle in numberOfCopies particles of given weight.
+
+The copies are created at the interface as secondaries of the current step.
+As their first step does not start from a geometry boundary, they are exported
+to the diagnostics here, the original particle being exported at its next step.
+*/
+void SteppingAction::SplitTrack(const G4Step* aStep, G4int numberOfCopies, G4double weight)
+{
+  G4Track* aTrack = aStep->GetTrack();
+  G4StepPoint* postStepPoint = aStep->GetPostStepPoint();
+  const G4ParticleDefinition* particle = aTrack->GetDefinition();
+
+  // Update the weight of the original particle
+  aTrack->SetWeight(weight);
+  postStepPoint->SetWeight(weight);
+
+  // Create the copies
+  G4TrackVector* secondaries = fpSteppingManager->GetfSecondary();
+  for (G4int i=1; i<numberOfCopies; i++)
+  {
+    G4Track* copy = new G4Track(*aTrack);
+    copy->SetWeight(weight);
+    copy->SetParentID(aTrack->GetTrackID());
+    copy->SetTouchableHandle(postStepPoint->GetTouchableHandle());
+    secondaries->push_back(copy);
+
+    if (!fResponseMatrix->IsBuilding() && fDiagnostics->FillDiagSurfacePhaseSpace(particle, postStepPoint))
+    {
+      ScoreRecord(GetLayerCopyNumber(postStepPoint), particle, postStepPoint);
+    }
+  }
 }
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
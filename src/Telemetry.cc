@@ -0,0 +1,357 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Telemetry.cc
+/// \brief Implementation of the Telemetry class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "Telemetry.hh"
+#include "RunTallies.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4Positron.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+  G4Mutex telemetryMutex = G4MUTEX_INITIALIZER;
+
+  /** \brief Number of values of each phase space row.*/
+  const G4int numberOfColumns = 8;
+
+  /** \brief Name of the species.*/
+  const char* speciesNames[] = {"e-", "gamma", "e+"};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Get particles definition and call SetCommands.
+
+*/
+Telemetry::Telemetry()
+: fMessenger(nullptr),
+  fFileName(""),
+  fShardSuffix(""),
+  fInterval(10.*s),
+  fRunID(0),
+  fNumberOfEvents(0),
+  fSegmentIndex(-1)
+{
+  fSpecies[0] = G4Electron::Definition();
+  fSpecies[1] = G4Gamma::Definition();
+  fSpecies[2] = G4Positron::Definition();
+
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+Telemetry::~Telemetry()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Reset the published counters and write the first status.
+
+This method is called by the master at the beginning of each run.
+*/
+void Telemetry::BeginOfRun(G4int runID, G4int numberOfEvents, G4int segmentIndex)
+{
+  if (fFileName == "") return;
+
+  G4AutoLock lock(&telemetryMutex);
+  fRunID = runID;
+  fNumberOfEvents = numberOfEvents;
+  fSegmentIndex = segmentIndex;
+  fStart = Clock::now();
+  fLastWrite = fStart;
+  fPublished.clear();
+  WriteStatus(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Count an event, and publish the thread counters if the interval has elapsed.
+
+This method is called by the workers at the beginning of each event, when the
+weight recorded by the previous event is complete in the run tallies.
+*/
+void Telemetry::ScoreEvent(const RunTallies& runTallies)
+{
+  if (fFileName == "") return;
+
+  Tallies& tallies = fThreadTallies.Get();
+  Clock::time_point now = Clock::now();
+  if (tallies.numberOfEvents == 0)
+  {
+    tallies.start = now;
+    tallies.lastPublish = now;
+  }
+  else
+  {
+    ScoreLastEvent(tallies, runTallies);
+  }
+  tallies.numberOfEvents++;
+
+  if (std::chrono::duration<G4double>(now - tallies.lastPublish).count() >= fInterval/s)
+  {
+    tallies.lastPublish = now;
+    Publish(tallies);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the weight recorded per species since the last call as one event.
+
+*/
+void Telemetry::ScoreLastEvent(Tallies& tallies, const RunTallies& runTallies)
+{
+  tallies.numberOfRows = runTallies.GetNumberOfRecords();
+  for (G4int i=0; i<3; i++)
+  {
+    G4double weight = runTallies.GetRecordedWeight(fSpecies[i]);
+    G4double eventWeight = weight - tallies.lastWeights[i];
+    tallies.sums[i]          += eventWeight;
+    tallies.sumsOfSquares[i] += eventWeight*eventWeight;
+    tallies.lastWeights[i] = weight;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Publish the final counters of a worker and reset them for the next run.
+
+This method is called by each worker at the end of each run.
+*/
+void Telemetry::MergeThreadTallies(const RunTallies& runTallies)
+{
+  if (fFileName == "") return;
+
+  Tallies& tallies = fThreadTallies.Get();
+  if (tallies.numberOfEvents > 0)
+  {
+    ScoreLastEvent(tallies, runTallies);
+    tallies.lastPublish = Clock::now();
+    Publish(tallies);
+  }
+  tallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the final status of the run.
+
+This method is called by the master at the end of each run.
+*/
+void Telemetry::EndOfRun()
+{
+  if (fFileName == "") return;
+
+  G4AutoLock lock(&telemetryMutex);
+  WriteStatus(true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Copy the counters of the thread, and rewrite the status file if the interval has elapsed.
+
+*/
+void Telemetry::Publish(const Tallies& tallies)
+{
+  G4AutoLock lock(&telemetryMutex);
+  fPublished[G4Threading::G4GetThreadId()] = tallies;
+
+  Clock::time_point now = Clock::now();
+  if (std::chrono::duration<G4double>(now - fLastWrite).count() >= fInterval/s)
+  {
+    fLastWrite = now;
+    WriteStatus(false);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the published counters in the status file.
+
+The relative error of the recorded weight W of a species is estimated from the
+weights w_i recorded by the N events as sqrt(N/(N-1) (sum w_i^2 - W^2/N))/W.
+The file is written under a temporary name, then renamed. This method must be
+called with the mutex locked.
+*/
+void Telemetry::WriteStatus(G4bool finished) const
+{
+  Clock::time_point now = Clock::now();
+  G4double elapsed = std::chrono::duration<G4double>(now - fStart).count();
+
+  // sum the counters of all the threads
+  G4long eventsDone = 0, numberOfRows = 0;
+  G4double sums[3] = {0., 0., 0.}, sumsOfSquares[3] = {0., 0., 0.};
+  for (const auto& it : fPublished)
+  {
+    eventsDone   += it.second.numberOfEvents;
+    numberOfRows += it.second.numberOfRows;
+    for (G4int i=0; i<3; i++)
+    {
+      sums[i]          += it.second.sums[i];
+      sumsOfSquares[i] += it.second.sumsOfSquares[i];
+    }
+  }
+  eventsDone = std::min(eventsDone, (G4long)fNumberOfEvents);
+  G4long eventsRemaining = fNumberOfEvents - eventsDone;
+  G4double eventRate = elapsed > 0. ? eventsDone/elapsed : 0.;
+
+  G4String fileName = GetFileName();
+  std::ofstream output(fileName + ".tmp");
+  output << "{" << G4endl;
+  output << "  \"state\": \"" << (finished ? "finished" : "running") << "\"," << G4endl;
+  output << "  \"run\": " << fRunID << "," << G4endl;
+  output << "  \"segment\": " << fSegmentIndex << "," << G4endl;
+  output << "  \"elapsed\": " << elapsed << "," << G4endl;
+  output << "  \"eventsDone\": " << eventsDone << "," << G4endl;
+  output << "  \"eventsRemaining\": " << eventsRemaining << "," << G4endl;
+  output << "  \"eventRate\": " << eventRate << "," << G4endl;
+  if (eventRate > 0.) output << "  \"eta\": " << eventsRemaining/eventRate << "," << G4endl;
+  else output << "  \"eta\": null," << G4endl;
+  output << "  \"threads\": [";
+  G4bool first = true;
+  for (const auto& it : fPublished)
+  {
+    G4double threadTime = std::chrono::duration<G4double>(it.second.lastPublish - it.second.start).count();
+    output << (first ? "" : ",") << G4endl
+           << "    {\"id\": " << it.first
+           << ", \"events\": " << it.second.numberOfEvents
+           << ", \"eventRate\": " << (threadTime > 0. ? it.second.numberOfEvents/threadTime : 0.) << "}";
+    first = false;
+  }
+  output << G4endl << "  ]," << G4endl;
+  output << "  \"rows\": " << numberOfRows << "," << G4endl;
+  output << "  \"outputBytes\": " << numberOfRows*numberOfColumns*sizeof(G4double) << "," << G4endl;
+  output << "  \"residentMemory\": " << GetResidentMemory() << "," << G4endl;
+  output << "  \"relativeError\": {";
+  for (G4int i=0; i<3; i++)
+  {
+    output << (i == 0 ? "" : ",") << G4endl << "    \"" << speciesNames[i] << "\": ";
+    G4double variance = (eventsDone > 1) ? (sumsOfSquares[i] - sums[i]*sums[i]/eventsDone)*eventsDone/(eventsDone - 1) : 0.;
+    if (eventsDone > 1 && sums[i] > 0.) output << std::sqrt(std::max(0., variance))/sums[i];
+    else output << "null";
+  }
+  output << G4endl << "  }" << G4endl;
+  output << "}" << G4endl;
+  output.close();
+
+  std::rename((fileName + ".tmp").c_str(), fileName.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the resident memory of the process in bytes, or -1 if unknown.
+
+*/
+G4long Telemetry::GetResidentMemory() const
+{
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  G4long size = 0, resident = -1;
+  if (statm >> size >> resident) return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return -1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the status file name, with the shard index before the extension.
+
+*/
+G4String Telemetry::GetFileName() const
+{
+  G4String fileName = fFileName;
+  size_t dot = fileName.rfind('.');
+  fileName.insert((dot == std::string::npos) ? fileName.size() : dot, fShardSuffix);
+  return fileName;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/telemetry/setFileName fileName
+/telemetry/setInterval time unit
+*/
+void Telemetry::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/telemetry/","Manage the live status file");
+
+  // define commands
+  G4GenericMessenger::Command& setFileNameCmd
+    = fMessenger->DeclareMethod("setFileName",
+                                &Telemetry::SetFileName,
+                                "Set the JSON status file updated during the runs (none for no file)");
+
+  G4GenericMessenger::Command& setIntervalCmd
+    = fMessenger->DeclarePropertyWithUnit("setInterval",
+                                "s",
+                                fInterval,
+                                "Set the minimum time between two updates of the status file");
+
+  // set commands properties
+  setFileNameCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setIntervalCmd.SetStates(G4State_PreInit,G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
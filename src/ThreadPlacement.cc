@@ -0,0 +1,188 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ThreadPlacement.cc
+/// \brief Implementation of the ThreadPlacement class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "ThreadPlacement.hh"
+
+#include "G4MTRunManager.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+#include <cctype>
+#include <iomanip>
+#include <string>
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+namespace { G4Mutex placementMutex = G4MUTEX_INITIALIZER; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Do nothing.
+
+*/
+ThreadPlacement::ThreadPlacement()
+: fReported(false)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Do nothing.
+
+*/
+ThreadPlacement::~ThreadPlacement()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the placement policy at the first run.
+
+This method is called by the master at the beginning of each run.
+*/
+void ThreadPlacement::BeginOfRun()
+{
+  if (fReported) return;
+
+  G4MTRunManager* mtRunManager = G4MTRunManager::GetMasterRunManager();
+  G4int pinAffinity = mtRunManager ? mtRunManager->GetPinAffinity() : 0;
+
+  G4cout << "Thread placement : " << GetNumberOfNodes() << " NUMA node(s) ; ";
+  if (pinAffinity == 0) G4cout << "workers not pinned (/run/pinAffinity n to pin them)";
+  else G4cout << "workers pinned with /run/pinAffinity " << pinAffinity;
+  G4cout << " ; input phase space and output buffers allocated per worker (first touch)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Record the core and NUMA node of the calling thread.
+
+This method is called by each worker at the beginning of each run, before the
+input file is read.
+*/
+void ThreadPlacement::RecordThread()
+{
+  if (fReported) return;
+
+  Placement placement = {-1, -1, -1};
+#ifdef __linux__
+  placement.cpu = sched_getcpu();
+  placement.node = GetNode(placement.cpu);
+  cpu_set_t mask;
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) placement.numberOfAllowed = CPU_COUNT(&mask);
+#endif
+
+  G4AutoLock lock(&placementMutex);
+  fPlacements[G4Threading::G4GetThreadId()] = placement;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print the core and NUMA node of each thread at the end of the first run.
+
+This method is called by the master at the end of each run.
+*/
+void ThreadPlacement::EndOfRun()
+{
+  G4AutoLock lock(&placementMutex);
+  if (fReported || fPlacements.empty()) return;
+  fReported = true;
+
+  G4cout << G4endl
+         << "--------------------Thread placement------------------------------" << G4endl
+         << "   thread     core     node  allowed cores" << G4endl;
+  for (const auto& it : fPlacements)
+  {
+    G4cout << std::setw(9)  << it.first
+           << std::setw(9)  << it.second.cpu
+           << std::setw(9)  << it.second.node
+           << std::setw(15) << it.second.numberOfAllowed << G4endl;
+  }
+  G4cout << "-----------------------------------------------------------------" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the number of NUMA nodes, 1 if unknown.
+
+*/
+G4int ThreadPlacement::GetNumberOfNodes() const
+{
+  G4int numberOfNodes = 0;
+#ifdef __linux__
+  DIR* dir = opendir("/sys/devices/system/node");
+  if (dir)
+  {
+    while (dirent* entry = readdir(dir))
+    {
+      std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") == 0 && name.size() > 4 && isdigit(name[4])) numberOfNodes++;
+    }
+    closedir(dir);
+  }
+#endif
+  return numberOfNodes > 0 ? numberOfNodes : 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the NUMA node of a core, -1 if unknown.
+
+The node is given by the `node<k>` link in the sysfs directory of the core.
+*/
+G4int ThreadPlacement::GetNode(G4int cpu) const
+{
+  if (cpu < 0) return -1;
+
+  G4int node = -1;
+#ifdef __linux__
+  DIR* dir = opendir(("/sys/devices/system/cpu/cpu" + std::to_string(cpu)).c_str());
+  if (dir)
+  {
+    while (dirent* entry = readdir(dir))
+    {
+      std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") == 0 && name.size() > 4 && isdigit(name[4])) node = std::stoi(name.substr(4));
+    }
+    closedir(dir);
+  }
+#endif
+  return node;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,247 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TraceRecorder.cc
+/// \brief Implementation of the TraceRecorder class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "TraceRecorder.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+
+#include <fstream>
+#include <iomanip>
+
+namespace { G4Mutex traceMutex = G4MUTEX_INITIALIZER; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Disable tracing and call SetCommands.
+
+*/
+TraceRecorder::TraceRecorder()
+: fMessenger(nullptr),
+  fFileName(""),
+  fShardSuffix(""),
+  fEnabled(false),
+  fMaximumSpans(1000000),
+  fStarted(false),
+  fNumberOfDropped(0)
+{
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+TraceRecorder::~TraceRecorder()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the trace origin at the first traced run.
+
+This method is called by the master at the beginning of each run. The spans of
+the successive runs (e.g. the segments of a segmented run) are kept in the same
+trace.
+*/
+void TraceRecorder::BeginOfRun()
+{
+  if (!fEnabled || fStarted) return;
+  fStarted = true;
+  fOrigin = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Append a span, from start to now, to the buffer of the thread.
+
+*/
+void TraceRecorder::AddSpan(const char* name, Clock::time_point start, G4int id)
+{
+  if (!fEnabled) return;
+
+  Buffer& buffer = fThreadBuffers.Get();
+  if ((G4int)buffer.spans.size() >= fMaximumSpans)
+  {
+    buffer.numberOfDropped++;
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  Span span;
+  span.name     = name;
+  span.id       = id;
+  span.start    = std::chrono::duration<G4double,std::micro>(start - fOrigin).count();
+  span.duration = std::chrono::duration<G4double,std::micro>(now - start).count();
+  buffer.spans.push_back(span);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Close the span of the previous event and open the one of this event.
+
+This method is called by the workers at the beginning of each event, so that an
+event span lasts until the next event of the thread starts.
+*/
+void TraceRecorder::ScoreEvent(G4int eventID)
+{
+  if (!fEnabled) return;
+
+  Buffer& buffer = fThreadBuffers.Get();
+  if (buffer.eventID >= 0) AddSpan("event", buffer.eventStart, buffer.eventID);
+  buffer.eventID = eventID;
+  buffer.eventStart = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Close the last event span and hand the buffer of the thread to the shared store.
+
+This method is called by each worker at the end of each run.
+*/
+void TraceRecorder::MergeThreadTallies()
+{
+  if (!fEnabled) return;
+
+  Buffer& buffer = fThreadBuffers.Get();
+  if (buffer.eventID >= 0) AddSpan("event", buffer.eventStart, buffer.eventID);
+
+  G4AutoLock lock(&traceMutex);
+  std::vector<Span>& spans = fSpans[G4Threading::G4GetThreadId()];
+  spans.insert(spans.end(), buffer.spans.begin(), buffer.spans.end());
+  fNumberOfDropped += buffer.numberOfDropped;
+  buffer = Buffer();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Hand the spans of the master to the shared store and write the trace file.
+
+This method is called by the master at the end of each run, and rewrites the
+file with all the spans since the first traced run.
+*/
+void TraceRecorder::EndOfRun()
+{
+  if (!fEnabled) return;
+
+  MergeThreadTallies();
+  WriteTrace();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Write the merged spans in the Chrome trace event format.
+
+Each span is a complete event (ph X) with times in microseconds, and each
+thread is named with a metadata event. In shard mode, the shard index is
+inserted before the file extension.
+*/
+void TraceRecorder::WriteTrace() const
+{
+  G4String fileName = fFileName;
+  size_t dot = fileName.rfind('.');
+  fileName.insert((dot == std::string::npos) ? fileName.size() : dot, fShardSuffix);
+
+  std::ofstream output(fileName);
+  output << std::fixed << std::setprecision(3);
+  output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  G4bool first = true;
+  size_t numberOfSpans = 0;
+  for (const auto& it : fSpans)
+  {
+    // Chrome trace thread ids start at 0 with the master
+    G4int tid = it.first + 1;
+    output << (first ? "" : ",") << G4endl
+           << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << tid
+           << ", \"args\": {\"name\": \""
+           << (it.first < 0 ? std::string("master") : "worker " + std::to_string(it.first)) << "\"}}";
+    first = false;
+
+    for (const Span& span : it.second)
+    {
+      output << "," << G4endl
+             << "{\"name\": \"" << span.name << "\", \"cat\": \"gp3m2\", \"ph\": \"X\""
+             << ", \"ts\": " << span.start << ", \"dur\": " << span.duration
+             << ", \"pid\": 0, \"tid\": " << tid;
+      if (span.id >= 0) output << ", \"args\": {\"id\": " << span.id << "}";
+      output << "}";
+    }
+    numberOfSpans += it.second.size();
+  }
+  output << G4endl << "]}" << G4endl;
+  output.close();
+
+  G4cout << "Trace of " << numberOfSpans << " spans written in " << fileName;
+  if (fNumberOfDropped > 0) G4cout << " (" << fNumberOfDropped << " spans dropped)";
+  G4cout << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/trace/setFileName fileName
+/trace/setMaximumSpans numberOfSpans
+*/
+void TraceRecorder::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/trace/","Manage the thread timeline trace");
+
+  // define commands
+  G4GenericMessenger::Command& setFileNameCmd
+    = fMessenger->DeclareMethod("setFileName",
+                                &TraceRecorder::SetFileName,
+                                "Record the thread timelines in this Chrome trace file (none for no tracing)");
+
+  G4GenericMessenger::Command& setMaximumSpansCmd
+    = fMessenger->DeclareProperty("setMaximumSpans",
+                                fMaximumSpans,
+                                "Set the maximum number of spans recorded per thread and run");
+
+  // set commands properties
+  setFileNameCmd.SetStates(G4State_PreInit,G4State_Idle);
+  setMaximumSpansCmd.SetStates(G4State_PreInit,G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
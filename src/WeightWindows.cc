@@ -0,0 +1,570 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file WeightWindows.cc
+/// \brief Implementation of the WeightWindows class
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#include "WeightWindows.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+namespace { G4Mutex mergeMutex = G4MUTEX_INITIALIZER; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set default window parameters and call SetCommands.
+
+The default upper and survival ratios are 5 and 2.5 times the lower bound.
+*/
+WeightWindows::WeightWindows()
+: fMessenger(nullptr),
+  fActive(false),
+  fNumberOfEnergyBands(1),
+  fEnergyMin(1.*keV),
+  fEnergyMax(1.*GeV),
+  fUpperRatio(5.),
+  fSurvivalRatio(2.5),
+  fMaxNumberOfCopies(100),
+  fFileNumberOfEvents(0),
+  fPilotFileName("")
+{
+  SetCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Delete messenger.
+
+*/
+WeightWindows::~WeightWindows()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return the logarithmic energy band of the given energy.
+
+Energies outside [fEnergyMin,fEnergyMax] are put in the first or last band.
+*/
+G4int WeightWindows::GetEnergyBand(G4double energy) const
+{
+  if (fNumberOfEnergyBands == 1 || energy <= fEnergyMin) return 0;
+  if (energy >= fEnergyMax) return fNumberOfEnergyBands - 1;
+
+  G4int band = (G4int)(fNumberOfEnergyBands * std::log(energy/fEnergyMin) / std::log(fEnergyMax/fEnergyMin));
+  return std::min(band, fNumberOfEnergyBands - 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Return true if a weight window is defined in at least one energy band of the layer.
+
+*/
+G4bool WeightWindows::HasWeightWindow(G4int layer) const
+{
+  if (!fActive || layer < 0) return false;
+
+  for (G4int band=0; band<fNumberOfEnergyBands; band++)
+  {
+    G4int cell = GetCellIndex(layer, band);
+    if (cell < (G4int)fLowerWeights.size() && fLowerWeights[cell] > 0.) return true;
+  }
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Apply the weight window of the given cell to a particle.
+
+Particles above the window are split, and particles below the window are played
+with Russian roulette. The weight is modified accordingly, and the returned
+value is the number of particles of this weight to transport (0 if killed).
+*/
+G4int WeightWindows::ApplyWeightWindow(G4int layer, G4double energy, G4double& weight)
+{
+  if (!fActive || layer < 0) return 1;
+
+  G4int cell = GetCellIndex(layer, GetEnergyBand(energy));
+  if (cell >= (G4int)fLowerWeights.size() || fLowerWeights[cell] <= 0.) return 1;
+
+  G4double lowerWeight    = fLowerWeights[cell];
+  G4double upperWeight    = lowerWeight * fUpperRatio;
+  G4double survivalWeight = lowerWeight * fSurvivalRatio;
+
+  Tallies& tallies = fThreadTallies.Get();
+
+  if (weight > upperWeight)
+  {
+    // Splitting
+    G4int numberOfCopies = std::min((G4int)std::ceil(weight/survivalWeight), fMaxNumberOfCopies);
+    weight /= numberOfCopies;
+    tallies.numberOfSplits++;
+    tallies.numberOfCopies += numberOfCopies - 1;
+    return numberOfCopies;
+  }
+  else if (weight < lowerWeight)
+  {
+    // Russian roulette
+    tallies.numberOfRoulettes++;
+    if (G4UniformRand() < weight/survivalWeight)
+    {
+      weight = survivalWeight;
+      return 1;
+    }
+    tallies.numberOfKills++;
+    return 0;
+  }
+
+  return 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Score a particle entering a cell, to generate the weight windows at the end of a pilot run.
+
+*/
+void WeightWindows::ScorePilot(G4int layer, G4double energy, G4double weight)
+{
+  if (layer < 0) return;
+
+  Tallies& tallies = fThreadTallies.Get();
+  G4int cell = GetCellIndex(layer, GetEnergyBand(energy));
+  if (cell >= (G4int)tallies.pilotWeights.size())
+  {
+    tallies.pilotWeights.resize(cell+1, 0.);
+    tallies.pilotCounts.resize(cell+1, 0.);
+  }
+  tallies.pilotWeights[cell] += weight;
+  tallies.pilotCounts[cell]  += 1.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Build the windows of the run and reset the merged tallies.
+
+Windows read from a file are rescaled by the ratio between the number of events
+of the pilot run and of the current run, as the input weights are normalized by
+the number of events. Windows given with the UI are used as is.
+
+This method is called by the master at the beginning of each run.
+*/
+void WeightWindows::BeginOfRun(G4int numberOfEvents)
+{
+  fLowerWeights.clear();
+
+  G4double scale = (fFileNumberOfEvents > 0 && numberOfEvents > 0)
+                 ? (G4double)fFileNumberOfEvents/(G4double)numberOfEvents : 1.;
+
+  for (const auto& it : fFileLowerWeights)
+  {
+    for (G4int band=0; band<(G4int)it.second.size(); band++)
+    {
+      G4int cell = GetCellIndex(it.first, band);
+      if (cell >= (G4int)fLowerWeights.size()) fLowerWeights.resize(cell+1, 0.);
+      fLowerWeights[cell] = it.second[band] * scale;
+    }
+  }
+
+  for (const auto& it : fManualLowerWeights)
+  {
+    for (G4int band=0; band<fNumberOfEnergyBands; band++)
+    {
+      G4int cell = GetCellIndex(it.first, band);
+      if (cell >= (G4int)fLowerWeights.size()) fLowerWeights.resize(cell+1, 0.);
+      fLowerWeights[cell] = it.second;
+    }
+  }
+
+  fActive = !fLowerWeights.empty();
+  fMergedTallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Add the tallies of the current thread to the merged tallies.
+
+This method is called by each worker at the end of the run.
+*/
+void WeightWindows::MergeThreadTallies()
+{
+  Tallies& tallies = fThreadTallies.Get();
+
+  G4AutoLock lock(&mergeMutex);
+  fMergedTallies.numberOfSplits    += tallies.numberOfSplits;
+  fMergedTallies.numberOfCopies    += tallies.numberOfCopies;
+  fMergedTallies.numberOfRoulettes += tallies.numberOfRoulettes;
+  fMergedTallies.numberOfKills     += tallies.numberOfKills;
+
+  if (tallies.pilotWeights.size() > fMergedTallies.pilotWeights.size())
+  {
+    fMergedTallies.pilotWeights.resize(tallies.pilotWeights.size(), 0.);
+    fMergedTallies.pilotCounts.resize(tallies.pilotCounts.size(), 0.);
+  }
+  for (size_t cell=0; cell<tallies.pilotWeights.size(); cell++)
+  {
+    fMergedTallies.pilotWeights[cell] += tallies.pilotWeights[cell];
+    fMergedTallies.pilotCounts[cell]  += tallies.pilotCounts[cell];
+  }
+  lock.unlock();
+
+  // reset thread tallies for the next run
+  tallies = Tallies();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Print weight windows statistics and write generated windows in pilot mode.
+
+The generated lower bound of each cell is chosen so that the window is centered
+on the mean weight of the particles entering the cell during the pilot run.
+
+This method is called by the master at the end of each run.
+*/
+void WeightWindows::EndOfRun(G4int numberOfEvents)
+{
+  if (fActive)
+  {
+    G4cout << G4endl
+           << "--------------------Weight windows statistics--------------------" << G4endl
+           << " Particles split            : " << fMergedTallies.numberOfSplits << G4endl
+           << " Copies created             : " << fMergedTallies.numberOfCopies << G4endl
+           << " Russian roulettes played   : " << fMergedTallies.numberOfRoulettes << G4endl
+           << " Particles killed           : " << fMergedTallies.numberOfKills << G4endl
+           << "-----------------------------------------------------------------" << G4endl;
+  }
+
+  if (IsPilot())
+  {
+    std::ofstream output(fPilotFileName);
+    output << "# Weight windows generated by gp3m2" << G4endl;
+    output << "# numberOfEnergyBands  energyMin (MeV)  energyMax (MeV)  numberOfEvents" << G4endl;
+    output << fNumberOfEnergyBands << " " << fEnergyMin/MeV << " " << fEnergyMax/MeV << " " << numberOfEvents << G4endl;
+    output << "# layer  band  lowerWeight" << G4endl;
+
+    for (size_t cell=0; cell<fMergedTallies.pilotWeights.size(); cell++)
+    {
+      if (fMergedTallies.pilotCounts[cell] == 0.) continue;
+      G4double meanWeight = fMergedTallies.pilotWeights[cell] / fMergedTallies.pilotCounts[cell];
+      output << cell / fNumberOfEnergyBands << " " << cell % fNumberOfEnergyBands << " "
+             << 2. * meanWeight / (1. + fUpperRatio) << G4endl;
+    }
+    output.close();
+
+    G4cout << "Weight windows written in " << fPilotFileName << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the lower bound of the window of the given layer, for all energy bands.
+
+The weight is given in the unit of the output weights of the next run.
+A lower bound of 0 removes the window.
+*/
+void WeightWindows::SetWeightWindow(G4int layer, G4double lowerWeight)
+{
+  if (layer < 0 || lowerWeight < 0.)
+  {
+    G4cerr << "Invalid weight window : " << layer << " " << lowerWeight << G4endl;
+    return;
+  }
+  fManualLowerWeights[layer] = lowerWeight;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the number of logarithmic energy bands.
+
+The number of bands of windows read from a file is the one of the file, and
+cannot be changed while they are loaded.
+*/
+void WeightWindows::SetNumberOfEnergyBands(G4int numberOfEnergyBands)
+{
+  if (numberOfEnergyBands <= 0)
+  {
+    G4cerr << "Invalid number of energy bands : " << numberOfEnergyBands << G4endl;
+    return;
+  }
+  if (!fFileLowerWeights.empty() && numberOfEnergyBands != fNumberOfEnergyBands)
+  {
+    G4cerr << "Weight windows read from a file with " << fNumberOfEnergyBands
+           << " energy bands, the number of bands cannot be changed" << G4endl;
+    return;
+  }
+  fNumberOfEnergyBands = numberOfEnergyBands;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Read weight windows from a file, as written by a pilot run.
+
+The file format is :
+numberOfEnergyBands  energyMin(MeV)  energyMax(MeV)  numberOfEvents
+layer  band  lowerWeight
+layer  band  lowerWeight
+...
+
+with lines starting with # being ignored.
+*/
+void WeightWindows::ReadWeightWindowsFile(G4String fileName)
+{
+  std::ifstream input(fileName);
+  if (!input)
+  {
+    G4cerr << "Weight windows file " << fileName << " not found ..." << G4endl;
+    return;
+  }
+
+  std::map<G4int,std::vector<G4double>> fileLowerWeights;
+  G4int numberOfEnergyBands = 0, numberOfEvents = 0;
+  G4double energyMin = 0., energyMax = 0.;
+
+  std::string str;
+  G4bool headerRead = false;
+  while (std::getline(input, str))
+  {
+    if (str.empty() || str[0] == '#') continue;
+    std::stringstream ss(str);
+
+    if (!headerRead)
+    {
+      if (!(ss >> numberOfEnergyBands >> energyMin >> energyMax >> numberOfEvents)
+          || numberOfEnergyBands <= 0 || energyMin <= 0. || energyMax <= energyMin || numberOfEvents <= 0)
+      {
+        G4cerr << "Invalid header in weight windows file " << fileName << " : " << str << G4endl;
+        return;
+      }
+      headerRead = true;
+      continue;
+    }
+
+    G4int layer = -1, band = -1;
+    G4double lowerWeight = -1.;
+    if (!(ss >> layer >> band >> lowerWeight)
+        || layer < 0 || band < 0 || band >= numberOfEnergyBands || lowerWeight < 0.)
+    {
+      G4cerr << "Invalid line in weight windows file " << fileName << " : " << str << G4endl;
+      return;
+    }
+
+    std::vector<G4double>& bands = fileLowerWeights[layer];
+    bands.resize(numberOfEnergyBands, 0.);
+    bands[band] = lowerWeight;
+  }
+  input.close();
+
+  if (!headerRead)
+  {
+    G4cerr << "No header in weight windows file " << fileName << G4endl;
+    return;
+  }
+
+  // the file is only used once fully read
+  fFileLowerWeights = fileLowerWeights;
+  fNumberOfEnergyBands = numberOfEnergyBands;
+  fEnergyMin = energyMin * MeV;
+  fEnergyMax = energyMax * MeV;
+  fFileNumberOfEvents = numberOfEvents;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the lower edge of the energy bands.
+
+The energy bands of windows read from a file are the ones of the file, and
+cannot be changed while they are loaded.
+*/
+void WeightWindows::SetEnergyMin(G4double energyMin)
+{
+  if (energyMin <= 0. || energyMin >= fEnergyMax)
+  {
+    G4cerr << "Invalid weight windows energy min : " << energyMin/MeV << " MeV, the max is "
+           << fEnergyMax/MeV << " MeV" << G4endl;
+    return;
+  }
+  if (!fFileLowerWeights.empty() && energyMin != fEnergyMin)
+  {
+    G4cerr << "Weight windows read from a file, the energy bands cannot be changed" << G4endl;
+    return;
+  }
+  fEnergyMin = energyMin;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the upper edge of the energy bands.
+
+*/
+void WeightWindows::SetEnergyMax(G4double energyMax)
+{
+  if (energyMax <= fEnergyMin)
+  {
+    G4cerr << "Invalid weight windows energy max : " << energyMax/MeV << " MeV, the min is "
+           << fEnergyMin/MeV << " MeV" << G4endl;
+    return;
+  }
+  if (!fFileLowerWeights.empty() && energyMax != fEnergyMax)
+  {
+    G4cerr << "Weight windows read from a file, the energy bands cannot be changed" << G4endl;
+    return;
+  }
+  fEnergyMax = energyMax;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the ratio between the upper and lower bounds of a window.
+
+The ratio must not be smaller than the survival ratio.
+*/
+void WeightWindows::SetUpperRatio(G4double upperRatio)
+{
+  if (upperRatio < 1. || upperRatio < fSurvivalRatio)
+  {
+    G4cerr << "Invalid weight windows upper ratio : " << upperRatio
+           << ", it must be >= 1 and >= the survival ratio " << fSurvivalRatio << G4endl;
+    return;
+  }
+  fUpperRatio = upperRatio;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Set the ratio between the survival weight and the lower bound of a window.
+
+The survival weight must be inside the window, i.e. 1 <= survival <= upper ratio.
+*/
+void WeightWindows::SetSurvivalRatio(G4double survivalRatio)
+{
+  if (survivalRatio < 1. || survivalRatio > fUpperRatio)
+  {
+    G4cerr << "Invalid weight windows survival ratio : " << survivalRatio
+           << ", it must be >= 1 and <= the upper ratio " << fUpperRatio << G4endl;
+    return;
+  }
+  fSurvivalRatio = survivalRatio;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+\brief Define UI commands.
+
+/bias/setWeightWindow layer lowerWeight
+/bias/readWeightWindows fileName
+/bias/generateWeightWindows fileName
+/bias/setWeightWindowsEnergyBands number
+/bias/setWeightWindowsEnergyMin value unit
+/bias/setWeightWindowsEnergyMax value unit
+/bias/setWeightWindowsUpperRatio ratio
+/bias/setWeightWindowsSurvivalRatio ratio
+*/
+void WeightWindows::SetCommands()
+{
+  // get UI messenger
+  fMessenger = new G4GenericMessenger(this,"/bias/","Manage variance reduction");
+
+  // define commands
+  G4GenericMessenger::Command& setWeightWindowCmd
+    = fMessenger->DeclareMethod("setWeightWindow",
+                                &WeightWindows::SetWeightWindow,
+                                "Set the lower weight bound of a layer (0 to remove the window)");
+
+  G4GenericMessenger::Command& readWeightWindowsCmd
+    = fMessenger->DeclareMethod("readWeightWindows",
+                                &WeightWindows::ReadWeightWindowsFile,
+                                "Read weight windows from a file");
+
+  G4GenericMessenger::Command& generateWeightWindowsCmd
+    = fMessenger->DeclareMethod("generateWeightWindows",
+                                &WeightWindows::SetPilotFileName,
+                                "Generate weight windows in the given file at the end of the next runs (none to stop)");
+
+  G4GenericMessenger::Command& setEnergyBandsCmd
+    = fMessenger->DeclareMethod("setWeightWindowsEnergyBands",
+                                &WeightWindows::SetNumberOfEnergyBands,
+                                "Set the number of logarithmic energy bands");
+
+  G4GenericMessenger::Command& setEnergyMinCmd
+    = fMessenger->DeclareMethodWithUnit("setWeightWindowsEnergyMin",
+                                "MeV",
+                                &WeightWindows::SetEnergyMin,
+                                "Set the lower edge of the energy bands");
+
+  G4GenericMessenger::Command& setEnergyMaxCmd
+    = fMessenger->DeclareMethodWithUnit("setWeightWindowsEnergyMax",
+                                "MeV",
+                                &WeightWindows::SetEnergyMax,
+                                "Set the upper edge of the energy bands");
+
+  G4GenericMessenger::Command& setUpperRatioCmd
+    = fMessenger->DeclareMethod("setWeightWindowsUpperRatio",
+                                &WeightWindows::SetUpperRatio,
+                                "Set the ratio between upper and lower bounds");
+
+  G4GenericMessenger::Command& setSurvivalRatioCmd
+    = fMessenger->DeclareMethod("setWeightWindowsSurvivalRatio",
+                                &WeightWindows::SetSurvivalRatio,
+                                "Set the ratio between survival weight and lower bound");
+
+  // set commands properties
+  setWeightWindowCmd.SetStates(G4State_Idle);
+  readWeightWindowsCmd.SetStates(G4State_Idle);
+  generateWeightWindowsCmd.SetStates(G4State_Idle);
+  setEnergyBandsCmd.SetStates(G4State_Idle);
+  setEnergyBandsCmd.SetParameterName("bands", false);
+  setEnergyBandsCmd.SetRange("bands>0");
+  setEnergyMinCmd.SetStates(G4State_Idle);
+  setEnergyMaxCmd.SetStates(G4State_Idle);
+  setUpperRatioCmd.SetStates(G4State_Idle);
+  setSurvivalRatioCmd.SetStates(G4State_Idle);
+}